@@ -0,0 +1,76 @@
+/**
+ * BlockedBloomFilter.cpp
+ */
+
+#include "BlockedBloomFilter.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+    // odd multipliers from the Parquet split block Bloom filter spec, one per word
+    constexpr uint32_t SALT[8] = {
+        0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+        0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+    };
+}
+
+BlockedBloomFilter::BlockedBloomFilter(size_t expectedKeys, size_t bitsPerKey) {
+    this->bitsPerKey = std::max<size_t>(1, bitsPerKey);
+    reset(expectedKeys);
+}
+
+void BlockedBloomFilter::reset(size_t expectedKeys) {
+    size_t count = std::max<size_t>(1, (expectedKeys * bitsPerKey + 511) / 512);
+    blocks.assign(count, Block{});
+}
+
+uint64_t BlockedBloomFilter::mix(uint64_t x) {
+    // splitmix64 finalizer, callers pass std::hash values which can be weak in the high bits
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+size_t BlockedBloomFilter::blockOf(uint64_t mixed) const {
+    // high 32 bits pick the block (multiply-shift instead of modulo), low 32 bits pick the bits
+    return static_cast<size_t>(((mixed >> 32) * blocks.size()) >> 32);
+}
+
+uint64_t BlockedBloomFilter::maskOf(uint64_t mixed, size_t i) {
+    uint32_t low = static_cast<uint32_t>(mixed);
+    return uint64_t(1) << ((low * SALT[i]) >> 26);
+}
+
+void BlockedBloomFilter::insert(uint64_t hash) {
+    uint64_t mixed = mix(hash);
+    Block& block = blocks[blockOf(mixed)];
+    for (size_t i = 0; i < 8; ++i) {
+        block.words[i] |= maskOf(mixed, i);
+    }
+}
+
+void BlockedBloomFilter::insertConcurrent(uint64_t hash) {
+    uint64_t mixed = mix(hash);
+    Block& block = blocks[blockOf(mixed)];
+    for (size_t i = 0; i < 8; ++i) {
+        std::atomic_ref<uint64_t>(block.words[i]).fetch_or(maskOf(mixed, i), std::memory_order_relaxed);
+    }
+}
+
+bool BlockedBloomFilter::mayContain(uint64_t hash) const {
+    uint64_t mixed = mix(hash);
+    const Block& block = blocks[blockOf(mixed)];
+    for (size_t i = 0; i < 8; ++i) {
+        if ((block.words[i] & maskOf(mixed, i)) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t BlockedBloomFilter::bytes() const {
+    return blocks.size() * sizeof(Block);
+}
@@ -0,0 +1,45 @@
+/**
+ * BlockedBloomFilter.h
+ */
+
+#ifndef BLOCKEDBLOOMFILTER_H
+#define BLOCKEDBLOOMFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// split block Bloom filter (the Parquet/Impala layout)
+// every key sets one bit in each of the 8 words of a single 64 byte block, so a query is
+// one cache line no matter what - a "no" from mayContain is definite, a "yes" only probable
+// there's no delete, owners rebuild it when enough removed keys have piled up
+class BlockedBloomFilter {
+    public:
+        // sized for expectedKeys at bitsPerKey (12 bits -> ~0.5% false positives)
+        explicit BlockedBloomFilter(size_t expectedKeys = 0, size_t bitsPerKey = 12);
+
+        void insert(uint64_t hash);
+        // same as insert, safe to call from several threads at once
+        void insertConcurrent(uint64_t hash);
+        bool mayContain(uint64_t hash) const;
+
+        // drop everything and resize for a new key count
+        void reset(size_t expectedKeys);
+
+        size_t bytes() const;
+
+    private:
+        struct alignas(64) Block {
+            uint64_t words[8];
+        };
+
+        std::vector<Block> blocks;
+        size_t bitsPerKey;
+
+        static uint64_t mix(uint64_t x);
+        size_t blockOf(uint64_t mixed) const;
+        // bit set in word i of the block
+        static uint64_t maskOf(uint64_t mixed, size_t i);
+};
+
+#endif
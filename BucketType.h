@@ -0,0 +1,16 @@
+/**
+ * BucketType.h
+ */
+
+#ifndef BUCKETTYPE_H
+#define BUCKETTYPE_H
+
+// Create an enum for the bucket type
+// NORMAL - not empty,
+// ESS - empty since start,
+// EAR - empty after removal
+enum class BucketType {
+    NORMAL, ESS, EAR
+};
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * CuckooHashTable.cpp
+ */
+
+#include "CuckooHashTable.h"
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+CuckooHashTable::CuckooHashTable(size_t initCapacity) {
+    trueSize = 0;
+    kickState = 0x2545f4914f6cdd1dULL;
+    std::random_device rd;
+    seed.k0 = (static_cast<uint64_t>(rd()) << 32) | rd();
+    seed.k1 = (static_cast<uint64_t>(rd()) << 32) | rd();
+
+    // at least two buckets so every key really has two choices
+    size_t buckets = 2;
+    while (buckets * SLOTS < initCapacity) {
+        buckets *= 2;
+    }
+    mask = buckets - 1;
+    tags.assign(buckets, 0);
+    slots.resize(buckets * SLOTS);
+}
+
+uint64_t CuckooHashTable::mix(uint64_t x) {
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t CuckooHashTable::hashKey(const std::string& key) const {
+    // keyed, not std::hash: more than SLOTS * 2 + MAX_STASH keys with one std::hash value would never fit,
+    // and every resize trying to make room would recurse into the next one
+    return sipHash13(key.data(), key.size(), seed);
+}
+
+uint8_t CuckooHashTable::tagOf(uint64_t hash) {
+    // top byte, buckets come from the low bits; 0 is reserved for empty
+    uint8_t tag = static_cast<uint8_t>(hash >> 56);
+    return tag == 0 ? 1 : tag;
+}
+
+size_t CuckooHashTable::firstBucket(uint64_t hash) const {
+    return static_cast<size_t>(hash) & mask;
+}
+
+size_t CuckooHashTable::secondBucket(uint64_t hash) const {
+    size_t first = firstBucket(hash);
+    size_t second = static_cast<size_t>(mix(hash ^ 0x9e3779b97f4a7c15ULL)) & mask;
+    return second != first ? second : first ^ 1;
+}
+
+uint8_t CuckooHashTable::tagAt(uint32_t word, size_t slot) {
+    return static_cast<uint8_t>(word >> (8 * slot));
+}
+
+uint32_t CuckooHashTable::withTag(uint32_t word, size_t slot, uint8_t tag) {
+    word &= ~(uint32_t(0xff) << (8 * slot));
+    return word | (uint32_t(tag) << (8 * slot));
+}
+
+const CuckooSlot* CuckooHashTable::find(const std::string& key, uint64_t hash) const {
+    uint8_t tag = tagOf(hash);
+    size_t candidates[2] = {firstBucket(hash), secondBucket(hash)};
+
+    // two buckets, SLOTS tags each, then the stash - never more than that
+    for (size_t b : candidates) {
+        uint32_t word = tags[b];
+        for (size_t s = 0; s < SLOTS; ++s) {
+            if (tagAt(word, s) == tag) {
+                const CuckooSlot& slot = slots[b * SLOTS + s];
+                if (slot.hash == hash && slot.key == key) {
+                    return &slot;
+                }
+            }
+        }
+    }
+    for (const auto& entry : stash) {
+        if (entry.hash == hash && entry.key == key) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+CuckooSlot* CuckooHashTable::find(const std::string& key, uint64_t hash) {
+    return const_cast<CuckooSlot*>(std::as_const(*this).find(key, hash));
+}
+
+bool CuckooHashTable::placeIn(size_t bucket, CuckooSlot& entry) {
+    for (size_t s = 0; s < SLOTS; ++s) {
+        if (tagAt(tags[bucket], s) == 0) {
+            slots[bucket * SLOTS + s] = std::move(entry);
+            tags[bucket] = withTag(tags[bucket], s, tagOf(slots[bucket * SLOTS + s].hash));
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CuckooHashTable::placeDirect(CuckooSlot& entry) {
+    return placeIn(firstBucket(entry.hash), entry) || placeIn(secondBucket(entry.hash), entry);
+}
+
+void CuckooHashTable::place(CuckooSlot entry) {
+    if (placeDirect(entry)) {
+        return;
+    }
+
+    // both buckets full - evict someone at random and send them to their other bucket
+    size_t bucket = (kickState & 1) ? firstBucket(entry.hash) : secondBucket(entry.hash);
+    for (size_t kick = 0; kick < MAX_KICKS; ++kick) {
+        kickState ^= kickState << 13;
+        kickState ^= kickState >> 7;
+        kickState ^= kickState << 17;
+        size_t s = static_cast<size_t>(kickState % SLOTS);
+
+        CuckooSlot& victim = slots[bucket * SLOTS + s];
+        std::swap(entry, victim);
+        tags[bucket] = withTag(tags[bucket], s, tagOf(victim.hash));
+
+        // entry is now the evicted one, its other bucket is the only place left for it
+        size_t first = firstBucket(entry.hash);
+        bucket = (bucket == first) ? secondBucket(entry.hash) : first;
+        if (placeIn(bucket, entry)) {
+            return;
+        }
+    }
+
+    // displacement path too long
+    if (stash.size() < MAX_STASH) {
+        stash.push_back(std::move(entry));
+        return;
+    }
+    resize();
+    place(std::move(entry));
+}
+
+bool CuckooHashTable::insert(const std::string& key, const size_t& value) {
+    uint64_t hash = hashKey(key);
+    if (find(key, hash) != nullptr) {
+        return false; // repeated item
+    }
+
+    // check load factor and resize if needed
+    if (static_cast<double>(trueSize + 1) > MAX_ALPHA * static_cast<double>(capacity())) {
+        resize();
+    }
+
+    place(CuckooSlot{key, value, hash});
+    trueSize++;
+    return true;
+}
+
+size_t CuckooHashTable::size() const {
+    return trueSize;
+}
+
+double CuckooHashTable::alpha() const {
+    return static_cast<double>(trueSize) / static_cast<double>(capacity());
+}
+
+bool CuckooHashTable::contains(const std::string& key) const {
+    return find(key, hashKey(key)) != nullptr;
+}
+
+std::optional<size_t> CuckooHashTable::get(const std::string& key) const {
+    const CuckooSlot* slot = find(key, hashKey(key));
+    if (slot == nullptr) {
+        return std::nullopt;
+    }
+    return slot->value;
+}
+
+bool CuckooHashTable::remove(const std::string& key) {
+    CuckooSlot* slot = find(key, hashKey(key));
+    if (slot == nullptr) {
+        return false;
+    }
+
+    if (slot >= stash.data() && slot < stash.data() + stash.size()) {
+        stash.erase(stash.begin() + (slot - stash.data()));
+    } else {
+        size_t index = static_cast<size_t>(slot - slots.data());
+        tags[index / SLOTS] = withTag(tags[index / SLOTS], index % SLOTS, 0); // no tombstones needed
+        slot->key.clear();
+
+        // a slot just opened up, see if anything stashed can go back into the table
+        for (size_t i = 0; i < stash.size();) {
+            if (placeDirect(stash[i])) {
+                stash.erase(stash.begin() + static_cast<std::ptrdiff_t>(i));
+            } else {
+                ++i;
+            }
+        }
+    }
+    trueSize--;
+    return true;
+}
+
+size_t& CuckooHashTable::operator[](const std::string& key) {
+    CuckooSlot* slot = find(key, hashKey(key));
+    if (slot == nullptr) {
+        throw std::runtime_error("Key not found");
+    }
+    return slot->value;
+}
+
+std::vector<std::string> CuckooHashTable::keys() const {
+    std::vector<std::string> keys;
+    keys.reserve(trueSize);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        if (tagAt(tags[i / SLOTS], i % SLOTS) != 0) {
+            keys.push_back(slots[i].key);
+        }
+    }
+    for (const auto& entry : stash) {
+        keys.push_back(entry.key);
+    }
+    return keys;
+}
+
+size_t CuckooHashTable::capacity() const {
+    return slots.size();
+}
+
+size_t CuckooHashTable::stashSize() const {
+    return stash.size();
+}
+
+void CuckooHashTable::resize() {
+    rehash(capacity() * 2);
+}
+
+void CuckooHashTable::rehash(size_t newCapacity) {
+    // room for everything under MAX_ALPHA, power of two buckets
+    size_t needed = std::max(newCapacity, static_cast<size_t>(static_cast<double>(trueSize) / MAX_ALPHA) + 1);
+    size_t buckets = 2;
+    while (buckets * SLOTS < needed) {
+        buckets *= 2;
+    }
+
+    std::vector<uint32_t> oldTags(buckets, 0);
+    std::vector<CuckooSlot> oldSlots(buckets * SLOTS);
+    std::vector<CuckooSlot> oldStash;
+    oldTags.swap(tags);
+    oldSlots.swap(slots);
+    oldStash.swap(stash);
+    mask = buckets - 1;
+
+    // place() can resize again if a key still won't fit, old* are ours so that's fine
+    for (size_t i = 0; i < oldSlots.size(); ++i) {
+        if (tagAt(oldTags[i / SLOTS], i % SLOTS) != 0) {
+            place(std::move(oldSlots[i]));
+        }
+    }
+    for (auto& entry : oldStash) {
+        place(std::move(entry));
+    }
+}
+
+void CuckooHashTable::reserve(size_t count) {
+    if (static_cast<double>(count) > MAX_ALPHA * static_cast<double>(capacity())) {
+        rehash(static_cast<size_t>(static_cast<double>(count) / MAX_ALPHA) + 1);
+    }
+}
+
+void CuckooHashTable::clear() {
+    std::fill(tags.begin(), tags.end(), 0);
+    for (auto& slot : slots) {
+        slot.key.clear();
+    }
+    stash.clear();
+    trueSize = 0;
+}
+
+std::ostream& operator<<(std::ostream& os, const CuckooHashTable& t) {
+    for (size_t i = 0; i < t.slots.size(); ++i) {
+        if (CuckooHashTable::tagAt(t.tags[i / CuckooHashTable::SLOTS], i % CuckooHashTable::SLOTS) != 0) {
+            os << "Bucket " << i / CuckooHashTable::SLOTS << "." << i % CuckooHashTable::SLOTS
+               << ": <" << t.slots[i].key << ", " << t.slots[i].value << ">" << std::endl;
+        }
+    }
+    for (const auto& entry : t.stash) {
+        os << "Stash: <" << entry.key << ", " << entry.value << ">" << std::endl;
+    }
+    return os;
+}
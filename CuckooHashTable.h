@@ -0,0 +1,98 @@
+/**
+ * CuckooHashTable.h
+ */
+
+#ifndef CUCKOOHASHTABLE_H
+#define CUCKOOHASHTABLE_H
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "SipHash.h"
+
+// one key/value of a CuckooHashTable, the full hash is kept so moving it never rehashes the key
+struct CuckooSlot {
+    std::string key;
+    size_t value = 0;
+    uint64_t hash = 0;
+};
+
+// bucketized cuckoo hashing with the same interface as HashTable
+// - every key has exactly two candidate buckets of SLOTS slots each, plus a tiny stash
+// - a lookup reads the two 4 byte tag words, compares keys only where a tag matches and
+//   checks the stash, so get/contains/remove/operator[] are O(1) worst case
+// - insert kicks entries to their other bucket for at most MAX_KICKS steps, the one left
+//   over goes to the stash, a full stash means resize()
+// - keys are hashed with SipHash under a random per table key: both buckets come from that one
+//   hash, so keys picked to share a std::hash value can't pile up in the same two buckets
+class CuckooHashTable {
+    public:
+        static constexpr size_t SLOTS = 4; // per bucket
+
+        // capacity in slots, rounded up to a power of two number of buckets; default 8
+        CuckooHashTable(size_t initCapacity = 8);
+
+        friend std::ostream& operator<<(std::ostream& os, const CuckooHashTable& t);
+
+        bool insert(const std::string& key, const size_t& value);
+
+        size_t size() const;
+        double alpha() const;
+
+        bool contains(const std::string& key) const;
+
+        std::optional<size_t> get(const std::string& key) const;
+        bool remove(const std::string& key);
+
+        size_t& operator[](const std::string& key);
+
+        std::vector<std::string> keys() const;
+
+        size_t capacity() const;
+
+        void rehash(size_t newCapacity);
+        void reserve(size_t count);
+        void clear();
+
+        // entries currently in the stash
+        size_t stashSize() const;
+
+    private:
+        // SLOTS tags per bucket packed in one word, tag 0 means the slot is empty
+        std::vector<uint32_t> tags;
+        std::vector<CuckooSlot> slots; // bucket b owns slots [b * SLOTS, b * SLOTS + SLOTS)
+        std::vector<CuckooSlot> stash;
+        size_t trueSize; // includes the stash
+        size_t mask; // bucket count - 1
+        uint64_t kickState; // xorshift state for picking victims
+        SipKey seed; // random per table, see hashKey
+
+        static constexpr size_t MAX_KICKS = 500;
+        static constexpr size_t MAX_STASH = 4;
+        static constexpr double MAX_ALPHA = .9; // grow before insert gets expensive
+
+        static uint64_t mix(uint64_t x);
+        uint64_t hashKey(const std::string& key) const;
+        static uint8_t tagOf(uint64_t hash);
+        size_t firstBucket(uint64_t hash) const;
+        size_t secondBucket(uint64_t hash) const;
+        static uint8_t tagAt(uint32_t word, size_t slot);
+        static uint32_t withTag(uint32_t word, size_t slot, uint8_t tag);
+
+        // pointer to the slot (table or stash) holding key, nullptr if not there
+        const CuckooSlot* find(const std::string& key, uint64_t hash) const;
+        CuckooSlot* find(const std::string& key, uint64_t hash);
+        // put entry in a free slot of bucket, false if it's full
+        bool placeIn(size_t bucket, CuckooSlot& entry);
+        // put entry in a free slot of one of its buckets, false if both are full
+        bool placeDirect(CuckooSlot& entry);
+        // full insert path without the duplicate check, may move entry around, resize or stash
+        void place(CuckooSlot entry);
+        // double the bucket count and move everything over
+        void resize();
+};
+
+#endif
@@ -0,0 +1,176 @@
+/**
+ * FixedHashTable.h
+ */
+
+#ifndef FIXEDHASHTABLE_H
+#define FIXEDHASHTABLE_H
+
+#include "BucketType.h"
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// one bucket of a FixedHashTable, same three states as HashTableBucket
+struct FixedHashTableBucket {
+    std::string_view key;
+    size_t value = 0;
+    BucketType type = BucketType::ESS;
+};
+
+// fixed capacity table for small lookup tables known at build time
+// - std::array storage, no heap, no resize, capacity N is a power of two so the modulo is a mask
+// - everything is constexpr, so a table built from a literal list costs nothing at startup
+// - keys are string_views, the characters have to outlive the table (string literals are fine)
+// - probes triangular numbers (1, 3, 6, ...) instead of shuffled offsets, with N a power of two that
+//   still reaches every bucket and needs no random_device
+template <size_t N>
+class FixedHashTable {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "FixedHashTable capacity must be a power of two");
+
+    public:
+        constexpr FixedHashTable() = default;
+
+        // throws std::length_error (a compile error in constexpr context) when the list doesn't fit
+        // repeated keys keep the first value, same as insert()
+        constexpr FixedHashTable(std::initializer_list<std::pair<std::string_view, size_t>> init) {
+            for (const auto& entry : init) {
+                if (trueSize == N && !contains(entry.first)) {
+                    throw std::length_error("FixedHashTable is full");
+                }
+                insert(entry.first, entry.second);
+            }
+        }
+
+        // false for duplicates and when all N buckets are in use
+        constexpr bool insert(std::string_view key, size_t value) {
+            size_t home = hash(key);
+            std::optional<size_t> bucket;
+
+            for (size_t i = 0; i < N; ++i) {
+                size_t index = probe(home, i);
+                if (buckets[index].type == BucketType::ESS) {
+                    if (!bucket.has_value()) {
+                        bucket = index;
+                    }
+                    break; // nothing has been past here
+                }
+                if (buckets[index].type == BucketType::EAR) {
+                    if (!bucket.has_value()) {
+                        bucket = index;
+                    }
+                } else if (buckets[index].key == key) {
+                    return false; // dupe
+                }
+            }
+
+            if (!bucket.has_value()) {
+                return false; // full
+            }
+            buckets[bucket.value()].key = key;
+            buckets[bucket.value()].value = value;
+            buckets[bucket.value()].type = BucketType::NORMAL;
+            trueSize++;
+            return true;
+        }
+
+        constexpr size_t size() const {
+            return trueSize;
+        }
+
+        constexpr double alpha() const {
+            return static_cast<double>(trueSize) / static_cast<double>(N);
+        }
+
+        static constexpr size_t capacity() {
+            return N;
+        }
+
+        constexpr bool contains(std::string_view key) const {
+            return find(key).has_value();
+        }
+
+        constexpr std::optional<size_t> get(std::string_view key) const {
+            std::optional<size_t> index = find(key);
+            if (!index.has_value()) {
+                return std::nullopt;
+            }
+            return buckets[index.value()].value;
+        }
+
+        constexpr bool remove(std::string_view key) {
+            std::optional<size_t> index = find(key);
+            if (!index.has_value()) {
+                return false;
+            }
+            buckets[index.value()].type = BucketType::EAR;
+            trueSize--;
+            return true;
+        }
+
+        constexpr size_t& operator[](std::string_view key) {
+            std::optional<size_t> index = find(key);
+            if (!index.has_value()) {
+                throw std::runtime_error("Key not found");
+            }
+            return buckets[index.value()].value;
+        }
+
+        std::vector<std::string_view> keys() const {
+            std::vector<std::string_view> keys;
+            for (const auto& bucket : buckets) {
+                if (bucket.type == BucketType::NORMAL) {
+                    keys.push_back(bucket.key);
+                }
+            }
+            return keys;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const FixedHashTable& t) {
+            for (size_t i = 0; i < N; ++i) {
+                if (t.buckets[i].type == BucketType::NORMAL) {
+                    os << "Bucket " << i << ": <" << t.buckets[i].key << ", " << t.buckets[i].value << ">" << std::endl;
+                }
+            }
+            return os;
+        }
+
+    private:
+        std::array<FixedHashTableBucket, N> buckets{};
+        size_t trueSize = 0;
+
+        // FNV-1a, std::hash isn't constexpr
+        static constexpr size_t hash(std::string_view key) {
+            uint64_t h = 14695981039346656037ULL;
+            for (char c : key) {
+                h ^= static_cast<unsigned char>(c);
+                h *= 1099511628211ULL;
+            }
+            return static_cast<size_t>(h ^ (h >> 32)) & (N - 1);
+        }
+
+        static constexpr size_t probe(size_t home, size_t i) {
+            return (home + i * (i + 1) / 2) & (N - 1);
+        }
+
+        constexpr std::optional<size_t> find(std::string_view key) const {
+            size_t home = hash(key);
+            for (size_t i = 0; i < N; ++i) {
+                const FixedHashTableBucket& bucket = buckets[probe(home, i)];
+                if (bucket.type == BucketType::ESS) {
+                    return std::nullopt; // empty since start, can't be further along
+                }
+                if (bucket.type == BucketType::NORMAL && bucket.key == key) {
+                    return probe(home, i);
+                }
+            }
+            return std::nullopt;
+        }
+};
+
+#endif
@@ -0,0 +1,176 @@
+/**
+ * FrozenHashTable.cpp
+ */
+
+#include "FrozenHashTable.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+FrozenHashTable::FrozenHashTable(std::vector<std::pair<std::string, size_t>> entries) {
+    trueSize = entries.size();
+
+    size_t numSlots = std::max<size_t>(1, static_cast<size_t>(static_cast<double>(trueSize) / SLOT_LOAD) + 1);
+    size_t numGroups = std::max<size_t>(1, trueSize / KEYS_PER_GROUP);
+    slots.resize(numSlots);
+    pilots.resize(numGroups);
+
+    // position[i] = slot entry i ends up in
+    std::vector<uint64_t> hashes(trueSize);
+    std::vector<size_t> position(trueSize);
+
+    // a handful of seeds is plenty, needing more than one is already rare
+    std::random_device rd;
+    uint64_t base0 = (static_cast<uint64_t>(rd()) << 32) | rd();
+    uint64_t base1 = (static_cast<uint64_t>(rd()) << 32) | rd();
+    bool built = false;
+    for (int attempt = 0; attempt < 64 && !built; ++attempt) {
+        uint64_t step = 0x9e3779b97f4a7c15ULL * static_cast<uint64_t>(attempt + 1);
+        seed.k0 = mix(base0 + step);
+        seed.k1 = mix(base1 + step);
+        for (size_t i = 0; i < trueSize; ++i) {
+            hashes[i] = keyHash(entries[i].first);
+        }
+        built = build(hashes, position);
+    }
+    if (!built) {
+        throw std::runtime_error("FrozenHashTable could not find a perfect hash");
+    }
+
+    for (size_t i = 0; i < trueSize; ++i) {
+        FrozenHashTableSlot& s = slots[position[i]];
+        s.key = std::move(entries[i].first);
+        s.value = entries[i].second;
+        s.used = true;
+    }
+}
+
+uint64_t FrozenHashTable::mix(uint64_t x) {
+    // splitmix64 finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t FrozenHashTable::keyHash(std::string_view key) const {
+    return sipHash13(key.data(), key.size(), seed);
+}
+
+uint64_t FrozenHashTable::reduce(uint64_t x, size_t n) {
+    // maps x onto [0, n) with a multiply instead of a 64 bit modulo (Lemire's fastrange)
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(x) * n) >> 64);
+}
+
+size_t FrozenHashTable::group(uint64_t h) const {
+    return static_cast<size_t>(reduce(h, pilots.size()));
+}
+
+size_t FrozenHashTable::slot(uint64_t h, uint32_t pilot) const {
+    // the group came from the high bits of h, mixing in the pilot gives every pilot an unrelated slot
+    return static_cast<size_t>(reduce(mix(h ^ (0x9e3779b97f4a7c15ULL * (pilot + 1))), slots.size()));
+}
+
+bool FrozenHashTable::build(const std::vector<uint64_t>& hashes, std::vector<size_t>& position) {
+    // members of every group
+    std::vector<std::vector<size_t>> members(pilots.size());
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        members[group(hashes[i])].push_back(i);
+    }
+
+    // biggest groups first, while there's still plenty of room
+    std::vector<size_t> order(pilots.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return members[a].size() > members[b].size();
+    });
+
+    std::vector<bool> taken(slots.size(), false);
+    std::vector<size_t> tried; // slots of the group being placed
+
+    for (size_t g : order) {
+        pilots[g] = 0;
+        if (members[g].empty()) {
+            continue;
+        }
+
+        bool placed = false;
+        for (uint32_t pilot = 0; pilot < MAX_PILOT && !placed; ++pilot) {
+            tried.clear();
+            placed = true;
+            for (size_t i : members[g]) {
+                size_t s = slot(hashes[i], pilot);
+                // taken by an earlier group, or by another key of this one
+                if (taken[s] || std::find(tried.begin(), tried.end(), s) != tried.end()) {
+                    placed = false;
+                    break;
+                }
+                tried.push_back(s);
+            }
+            if (placed) {
+                pilots[g] = pilot;
+                for (size_t k = 0; k < tried.size(); ++k) {
+                    taken[tried[k]] = true;
+                    position[members[g][k]] = tried[k];
+                }
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t FrozenHashTable::size() const {
+    return trueSize;
+}
+
+double FrozenHashTable::alpha() const {
+    return static_cast<double>(trueSize) / static_cast<double>(slots.size());
+}
+
+size_t FrozenHashTable::capacity() const {
+    return slots.size();
+}
+
+bool FrozenHashTable::contains(const std::string& key) const {
+    return get(key).has_value();
+}
+
+std::optional<size_t> FrozenHashTable::get(const std::string& key) const {
+    // one slot per key, still compare since keys that were never inserted map somewhere too
+    uint64_t h = keyHash(key);
+    const FrozenHashTableSlot& s = slots[slot(h, pilots[group(h)])];
+    if (s.used && s.key == key) {
+        return s.value;
+    }
+    return std::nullopt;
+}
+
+std::vector<std::string> FrozenHashTable::keys() const {
+    std::vector<std::string> keys;
+    keys.reserve(trueSize);
+    for (const auto& s : slots) {
+        if (s.used) {
+            keys.push_back(s.key);
+        }
+    }
+    return keys;
+}
+
+size_t FrozenHashTable::pilotBytes() const {
+    return pilots.size() * sizeof(uint32_t);
+}
+
+std::ostream& operator<<(std::ostream& os, const FrozenHashTable& t) {
+    for (size_t i = 0; i < t.slots.size(); ++i) {
+        if (t.slots[i].used) {
+            os << "Slot " << i << ": <" << t.slots[i].key << ", " << t.slots[i].value << ">" << std::endl;
+        }
+    }
+    return os;
+}
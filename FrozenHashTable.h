@@ -0,0 +1,69 @@
+/**
+ * FrozenHashTable.h
+ */
+
+#ifndef FROZENHASHTABLE_H
+#define FROZENHASHTABLE_H
+
+#include "SipHash.h"
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// one slot of a FrozenHashTable, only the ~1% spare slots are unused
+struct FrozenHashTableSlot {
+    std::string key;
+    size_t value = 0;
+    bool used = false;
+};
+
+// read only table built once from a finished HashTable (see HashTable::freeze)
+// perfect hashing in the PTHash style: keys are split into small groups, and every group gets a
+// "pilot" number picked so that all of its keys land in slots nobody else has taken
+// lookups: hash once, read the group's pilot, go to exactly one slot, compare the key - no probing
+// slots are sized at n / .99 so almost nothing is empty (HashTable sits under .5)
+class FrozenHashTable {
+    public:
+        // keys have to be unique, HashTable::freeze guarantees that
+        explicit FrozenHashTable(std::vector<std::pair<std::string, size_t>> entries);
+
+        friend std::ostream& operator<<(std::ostream& os, const FrozenHashTable& t);
+
+        size_t size() const;
+        double alpha() const;
+        size_t capacity() const; // number of slots
+
+        bool contains(const std::string& key) const;
+        std::optional<size_t> get(const std::string& key) const;
+
+        std::vector<std::string> keys() const;
+
+        // bytes spent on pilots, the only overhead on top of the slots
+        size_t pilotBytes() const;
+
+    private:
+        std::vector<FrozenHashTableSlot> slots;
+        std::vector<uint32_t> pilots; // one per group
+        size_t trueSize;
+        // SipHash key, random per table and changed if a build attempt gets stuck and starts over
+        // keyed over the key bytes so keys that collide under one seed don't under the next
+        SipKey seed;
+
+        static constexpr double SLOT_LOAD = .99;
+        static constexpr size_t KEYS_PER_GROUP = 4;
+        static constexpr uint32_t MAX_PILOT = 1u << 20; // give up on this seed past here
+
+        static uint64_t mix(uint64_t x);
+        static uint64_t reduce(uint64_t x, size_t n);
+        uint64_t keyHash(std::string_view key) const;
+        size_t group(uint64_t h) const;
+        size_t slot(uint64_t h, uint32_t pilot) const;
+        // one attempt at placing every key with the current seed, false if some group ran out of pilots
+        bool build(const std::vector<uint64_t>& hashes, std::vector<size_t>& position);
+};
+
+#endif
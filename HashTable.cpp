@@ -3,54 +3,304 @@
  */
 
 #include "HashTable.h"
+#include "FrozenHashTable.h"
+#include "ThreadPool.h"
 #include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
 #include <functional>
 #include <iostream>
+#include <mutex>
 #include <ostream>
-#include <numeric>
 #include <random>
 #include <stdexcept>
 #include <utility>
 
-HashTable::HashTable(size_t initCapacity) {
+// one cache line per probe step, watch the field order when adding to the bucket
+// (alignas rounds the size up, so going past 64 bytes would double it)
+static_assert(sizeof(HashTableBucket) == 64, "HashTableBucket grew past a cache line");
+
+namespace {
+    // steady_clock means nothing after a restart, the log keeps wall clock deadlines (0 = none)
+    int64_t toWallClock(HashTable::Clock::time_point expiresAt) {
+        if (expiresAt == HashTable::Clock::time_point::max()) {
+            return 0;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::system_clock::duration>(expiresAt - HashTable::Clock::now());
+        auto wall = std::chrono::system_clock::now() + left;
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(wall.time_since_epoch()).count();
+        return std::max<int64_t>(ns, 1);
+    }
+
+    // rough size of the block an allocator hands out for a request of n bytes
+    size_t allocationSize(size_t n, bool pooled) {
+        if (pooled) {
+            return std::bit_ceil(n); // pool resources keep blocks in (about) power of two size classes
+        }
+        return std::max<size_t>(32, (n + 8 + 15) & ~size_t(15)); // glibc malloc: 8 byte header, 16 byte chunks
+    }
+
+    // murmur3 fmix64, the round function of OffsetPermutation
+    uint64_t mix64(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+    // random permutation of [0, count): a keyed 4 round Feistel network over the smallest even number of
+    // bits that covers count, applied again until the result lands inside the range (at most ~4 times on average)
+    // every index maps on its own, so unlike a Fisher-Yates shuffle the offsets can be filled in parallel
+    class OffsetPermutation {
+        public:
+            OffsetPermutation(size_t count, std::mt19937_64& gen) : count(count) {
+                size_t bits = std::max<size_t>(2, std::bit_width(count));
+                bits += bits & 1;
+                half = bits / 2;
+                mask = (uint64_t(1) << half) - 1;
+                for (auto& key : keys) {
+                    key = gen();
+                }
+            }
+
+            size_t operator()(size_t index) const {
+                uint64_t x = index;
+                do {
+                    uint64_t left = x >> half;
+                    uint64_t right = x & mask;
+                    for (uint64_t key : keys) {
+                        uint64_t next = left ^ (mix64(right ^ key) & mask);
+                        left = right;
+                        right = next;
+                    }
+                    x = (left << half) | right;
+                } while (x >= count);
+                return static_cast<size_t>(x);
+            }
+
+        private:
+            size_t count;
+            size_t half;
+            uint64_t mask;
+            uint64_t keys[4];
+    };
+
+    HashTable::Clock::time_point fromWallClock(int64_t deadline) {
+        auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+        auto left = std::chrono::nanoseconds(deadline) - now;
+        return HashTable::Clock::now() + std::chrono::duration_cast<HashTable::Clock::duration>(left);
+    }
+}
+
+HashTable::HashTable(size_t initCapacity)
+    : resource(std::pmr::get_default_resource()),
+      keyResource(resource),
+      buckets(resource),
+      offsets(resource) {
     trueSize = 0; // nothing in it yet
     currentCapacity = initCapacity; // set to the size input in constructor
 
-    buckets.resize(currentCapacity); // resize (vector) to initCapacity number of buckets
+    makeBuckets(); // initCapacity number of buckets
+
+    shuffleOffsets();
+}
+
+HashTable::HashTable(size_t initCapacity, std::pmr::memory_resource* upstream,
+                     std::pmr::memory_resource* bucketResource)
+    : keyPool(std::make_unique<KeyArena>(upstream)),
+      resource(bucketResource != nullptr ? bucketResource : upstream),
+      keyResource(&keyPool->pool),
+      buckets(resource),
+      offsets(resource) {
+    trueSize = 0;
+    currentCapacity = initCapacity;
+
+    makeBuckets();
+
+    shuffleOffsets();
+}
+
+HashTable::HashTable(const HashTable& other)
+    : keyPool(other.keyPool ? std::make_unique<KeyArena>(other.keyPool->counter.upstreamResource()) : nullptr),
+      resource(other.resource),
+      keyResource(keyPool ? &keyPool->pool : resource),
+      buckets(resource),
+      trueSize(other.trueSize),
+      currentCapacity(other.currentCapacity),
+      offsets(other.offsets.begin(), other.offsets.end(), resource),
+      workers(other.workers),
+      tombstones(other.tombstones),
+      expiringCount(other.expiringCount),
+      sweepCursor(other.sweepCursor),
+      maxEntries(other.maxEntries),
+      clockHand(other.clockHand),
+      evictions(other.evictions),
+      keyed(other.keyed),
+      hashKey(other.hashKey),
+      reseeds(other.reseeds) {
+    makeBuckets();
+    // key copies allocate, so with the (unsynchronized) arena this stays on the calling thread
+    forChunks(currentCapacity, !keyPool, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const HashTableBucket& from = other.buckets[i];
+            HashTableBucket& to = buckets[i];
+            to.type = from.type;
+            if (from.type == BucketType::NORMAL) {
+                to.key = from.key;
+                to.value = from.value;
+                to.expiresAt = from.expiresAt;
+                to.referenced = from.referenced;
+            }
+        }
+    });
+    if (other.filter) {
+        filter = std::make_unique<BlockedBloomFilter>();
+        rebuildFilter();
+    }
+}
+
+HashTable& HashTable::operator=(const HashTable& other) {
+    if (this != &other) {
+        *this = HashTable(other);
+    }
+    return *this;
+}
+
+HashTable& HashTable::operator=(HashTable&& other) noexcept {
+    if (this == &other) {
+        return *this;
+    }
+    if (log) {
+        try {
+            settleTouched(); // same as the destructor, this table's log is about to close
+        } catch (const std::exception&) {
+        }
+    }
+    // buckets before keyPool: the old keys have to go while the arena they came from is still around
+    buckets = std::move(other.buckets);
+    offsets = std::move(other.offsets);
+    keyPool = std::move(other.keyPool);
+    resource = other.resource;
+    keyResource = other.keyResource;
+    trueSize = other.trueSize;
+    currentCapacity = other.currentCapacity;
+    workers = other.workers;
+    tombstones = other.tombstones;
+    expiringCount = other.expiringCount;
+    sweepCursor = other.sweepCursor;
+    maxEntries = other.maxEntries;
+    clockHand = other.clockHand;
+    evictions = other.evictions;
+    filter = std::move(other.filter);
+    filterStale = other.filterStale;
+    keyed = other.keyed;
+    hashKey = other.hashKey;
+    reseeds = other.reseeds;
+    log = std::move(other.log);
+    snapshotGeneration = other.snapshotGeneration;
+    dirtyRanges = std::move(other.dirtyRanges);
+    snapshotCursor = other.snapshotCursor;
+    writesSinceSnapshot = other.writesSinceSnapshot;
+    touchedBuckets = std::move(other.touchedBuckets);
+    return *this;
+}
+
+HashTable::~HashTable() {
+    if (log) {
+        try {
+            settleTouched();
+        } catch (const std::exception&) {
+            // the log already failed, nobody left to tell
+        }
+    }
+}
+
+void HashTable::makeBuckets() {
+    // resize only allocates (DeferredAllocator), each bucket is built here so its key gets keyResource
+    buckets.resize(currentCapacity);
+    forChunks(currentCapacity, true, [this](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            ::new (static_cast<void*>(&buckets[i])) HashTableBucket(keyResource);
+        }
+    });
+}
 
+void HashTable::shuffleOffsets() {
     offsets.resize(currentCapacity - 1);
 
-    std::iota(offsets.begin(), offsets.end(), 1); // make the list of offsets starting with 1
     std::random_device rd; // seed for rng
-    std::mt19937 gen(rd()); // create rng
-    std::shuffle(offsets.begin(), offsets.end(), gen); // shuffle list
+    std::mt19937_64 gen(rd()); // create rng
+    OffsetPermutation permutation(offsets.size(), gen);
+    forChunks(offsets.size(), true, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            offsets[i] = permutation(i) + 1; // 1..capacity-1, each once
+        }
+    });
 }
 
-size_t HashTable::hash(const std::string& key) const {
-    size_t hashVal = std::hash<std::string>()(key);
+size_t HashTable::hash(std::string_view key) const {
+    size_t hashVal = rawHash(key);
     return hashVal % currentCapacity; // keep index within bounds
 }
 
+size_t HashTable::rawHash(std::string_view key) const {
+    if (keyed) {
+        return sipHash13(key.data(), key.size(), hashKey);
+    }
+    return std::hash<std::string_view>()(key); // same value std::hash<std::string> gives
+}
+
 bool HashTable::insert(const std::string& key, const size_t& value){
+    return insertUntil(key, value, NO_EXPIRY);
+}
+
+bool HashTable::insert(const std::string& key, const size_t& value, Clock::duration ttl) {
+    return insertUntil(key, value, Clock::now() + ttl);
+}
+
+bool HashTable::insertUntil(const std::string& key, const size_t& value, Clock::time_point expiresAt) {
+    sweepStep();
+    snapshotStep();
+
     // check load factor and resize if needed
     if (alpha() >= .5) {
         resize();
+    } else if (tombstones * 4 >= currentCapacity) {
+        // a quarter of the table is EAR - same size rebuild clears them out
+        rehash(currentCapacity);
     }
+    maybeRebuildFilter();
 
-    size_t home = hash(key); // get index
+    size_t raw = rawHash(key);
+    size_t home = raw % currentCapacity; // get index
 
     std::optional<size_t> bucket;
+    bool probe = true;
+    size_t collisions = 0; // live entries in the way, tombstones don't count
 
-    if (buckets[home].type != BucketType::NORMAL) {
-        // this bucket is, empty use it
+    if (buckets[home].type == BucketType::ESS) {
+        // this bucket is empty since start, use it
         bucket = home;
-    } else if (buckets[home].key == key) {
-        // repeated item
-        return false;
+        probe = false;
+    } else if (buckets[home].type == BucketType::EAR) {
+        // free, but the key can still be further along the probe path
+        bucket = home;
+    } else if (buckets[home].key == std::string_view(key)) {
+        if (!expired(buckets[home])) {
+            // repeated item
+            return false;
+        }
+        // expired copy, take its place
+        reclaim(buckets[home]);
+        bucket = home;
+        probe = false;
     }
 
-    // do p.r.probing if collision happened
-    if (buckets[home].type == BucketType::NORMAL) {
+    // do p.r.probing if collision happened (or home was removed from)
+    if (probe) {
         for (size_t i = 0; i < offsets.size(); ++i) {
             // use offsets vector to get new index
             // make sure to check for dupes
@@ -72,9 +322,20 @@ bool HashTable::insert(const std::string& key, const size_t& value){
             }
 
             if (buckets[probe].type == BucketType::NORMAL) {
-                if (buckets[probe].key == key) {
-                    // dupe
-                    return false;
+                if (buckets[probe].key == std::string_view(key)) {
+                    if (!expired(buckets[probe])) {
+                        // dupe
+                        return false;
+                    }
+                    // expired copy, nothing further along can match
+                    reclaim(buckets[probe]);
+                    if (!bucket.has_value()) {
+                        bucket = probe;
+                    }
+                    break;
+                }
+                if (!bucket.has_value()) {
+                    collisions++;
                 }
             }
         }
@@ -82,10 +343,35 @@ bool HashTable::insert(const std::string& key, const size_t& value){
 
     // actually make the insert
     if (bucket.has_value()) {
-        buckets[bucket.value()].key = key; // set key
-        buckets[bucket.value()].value = value; // set val
-        buckets[bucket.value()].type = BucketType::NORMAL; // occupied set to NORMAL
+        if (maxEntries != 0 && trueSize >= maxEntries) {
+            // at the limit, only touches NORMAL buckets so the one we picked stays free
+            evictOne();
+        }
+
+        HashTableBucket& target = buckets[bucket.value()];
+        if (target.type == BucketType::EAR) {
+            tombstones--; // reusing a removed slot
+        }
+        target.key = key; // set key
+        target.value = value; // set val
+        target.type = BucketType::NORMAL; // occupied set to NORMAL
+        target.expiresAt = expiresAt;
+        target.referenced = 0; // has to earn its keep
+        if (filter) {
+            filter->insert(raw);
+        }
+        if (expiresAt != NO_EXPIRY) {
+            expiringCount++;
+        }
         trueSize++; // inserted so increment true size count
+        if (log) {
+            markDirty(bucket.value());
+            logWrite(LogOp::PUT, key, value, expiresAt);
+        }
+        if (collisions > PROBE_LIMIT) {
+            // at alpha < .5 that's a 1 in 2^32 chance for honest keys, assume someone is picking them
+            reseed();
+        }
         return true;
     }
     return false; // should not be needed
@@ -103,38 +389,371 @@ double HashTable::alpha() const {
 
 // resizer - double when load factor >= .5
 void HashTable::resize() {
+    rehash(currentCapacity * 2);
+}
+
+void HashTable::rehash(size_t newCapacity) {
+    if (log) {
+        settleTouched(); // bucket indices are about to change
+    }
+
+    // don't carry expired entries into the new table
+    if (expiringCount > 0) {
+        Clock::time_point now = Clock::now();
+        for (auto& bucket : buckets) {
+            if (bucket.type == BucketType::NORMAL && bucket.expiresAt <= now) {
+                reclaim(bucket);
+            }
+        }
+    }
+
+    // keep alpha under .5 for what's already in here
+    newCapacity = std::max(newCapacity, trueSize * 2 + 1);
+
     // create a save of the current buckets
-    std::vector<HashTableBucket> temp = std::move(buckets);
+    BucketArray temp(resource);
+    temp.swap(buckets);
 
-    // double cap
-    currentCapacity = currentCapacity * 2;
+    currentCapacity = newCapacity;
+    makeBuckets();
 
-    buckets.resize(currentCapacity);
+    // new offsets for new capa
+    shuffleOffsets();
+    tombstones = 0;
+    sweepCursor = 0;
+    clockHand = 0;
+    if (filter) {
+        // placement below refills it
+        filter->reset(currentCapacity / 2);
+        filterStale = 0;
+    }
 
-    // new offsets for new capa, basically all the same as before in HashTable up top
-    offsets.resize(currentCapacity - 1);
-    std::iota(offsets.begin(), offsets.end(), 1);
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::shuffle(offsets.begin(), offsets.end(), gen);
+    if (workers != nullptr && workers->size() > 1 && temp.size() >= PARALLEL_REHASH_MIN) {
+        placeParallel(temp);
+    } else {
+        placeSerial(temp);
+    }
 
-    trueSize = 0;
+    if (log) {
+        newLayout(); // everything moved
+    }
+}
 
-    for (const auto& bucket : temp) {
-        if (bucket.type == BucketType::NORMAL) {
-            insert(bucket.key, bucket.value);
+void HashTable::reserve(size_t count) {
+    // same doubling as resize so capacities stay the same as if we'd grown one insert at a time
+    size_t newCapacity = currentCapacity;
+    while (static_cast<double>(count) / static_cast<double>(newCapacity) >= .5) {
+        newCapacity *= 2;
+    }
+    if (newCapacity != currentCapacity) {
+        rehash(newCapacity);
+    }
+}
+
+void HashTable::setThreadPool(ThreadPool* pool) {
+    workers = pool;
+}
+
+void HashTable::forChunks(size_t count, bool parallel, const std::function<void(size_t, size_t)>& fn) const {
+    if (parallel && workers != nullptr && workers->size() > 1 && count >= PARALLEL_REHASH_MIN) {
+        workers->parallelFor(count, fn);
+    } else {
+        fn(0, count);
+    }
+}
+
+size_t HashTable::locate(std::string_view key) const {
+    size_t home = hash(key);
+    for (size_t i = 0; i <= offsets.size(); ++i) {
+        size_t index = (i == 0) ? home : (home + offsets[i - 1]) % currentCapacity;
+        const HashTableBucket& probe = buckets[index];
+
+        if (probe.type == BucketType::ESS) {
+            return NOT_FOUND;
+        }
+        if (probe.type == BucketType::NORMAL && probe.key == key) {
+            return index;
         }
     }
+    return NOT_FOUND;
+}
+
+void HashTable::for_each(const std::function<void(std::string_view, size_t&)>& fn) {
+    Clock::time_point now = Clock::now(); // one clock read for the whole scan
+    std::atomic<size_t> changed{0};
+
+    forChunks(currentCapacity, true, [&](size_t begin, size_t end) {
+        size_t local = 0;
+        for (size_t i = begin; i < end; ++i) {
+            HashTableBucket& bucket = buckets[i];
+            if (bucket.type != BucketType::NORMAL || bucket.expiresAt <= now) {
+                continue;
+            }
+            size_t before = bucket.value;
+            fn(bucket.key, bucket.value);
+            if (log && bucket.value != before) {
+                markDirtyConcurrent(i);
+                log->append(LogOp::PUT, bucket.key, bucket.value, toWallClock(bucket.expiresAt));
+                local++;
+            }
+        }
+        changed.fetch_add(local, std::memory_order_relaxed);
+    });
+    writesSinceSnapshot += changed.load();
+}
+
+size_t HashTable::erase_if(const std::function<bool(std::string_view, size_t)>& pred) {
+    Clock::time_point now = Clock::now();
+    std::atomic<size_t> erased{0};
+    std::atomic<size_t> erasedExpiring{0};
+    // the arena isn't thread safe, so its keys are handed back after the scan
+    std::mutex freedLock;
+    std::vector<size_t> freed;
+
+    forChunks(currentCapacity, true, [&](size_t begin, size_t end) {
+        size_t count = 0;
+        size_t expiring = 0;
+        std::vector<size_t> local;
+        for (size_t i = begin; i < end; ++i) {
+            HashTableBucket& bucket = buckets[i];
+            if (bucket.type != BucketType::NORMAL || bucket.expiresAt <= now || !pred(bucket.key, bucket.value)) {
+                continue;
+            }
+            if (log) {
+                markDirtyConcurrent(i);
+                log->append(LogOp::REMOVE, bucket.key, 0, 0);
+            }
+            // reclaim() without the shared counters, those are added up below
+            if (bucket.expiresAt != NO_EXPIRY) {
+                expiring++;
+                bucket.expiresAt = NO_EXPIRY;
+            }
+            bucket.type = BucketType::EAR;
+            count++;
+            if (keyPool) {
+                local.push_back(i);
+            }
+        }
+        erased.fetch_add(count, std::memory_order_relaxed);
+        erasedExpiring.fetch_add(expiring, std::memory_order_relaxed);
+        if (!local.empty()) {
+            std::lock_guard<std::mutex> guard(freedLock);
+            freed.insert(freed.end(), local.begin(), local.end());
+        }
+    });
+
+    size_t removed = erased.load();
+    trueSize -= removed;
+    tombstones += removed;
+    expiringCount -= erasedExpiring.load();
+    if (filter) {
+        filterStale += removed;
+    }
+    if (log) {
+        writesSinceSnapshot += removed;
+    }
+
+    if (tombstones * 4 >= currentCapacity) {
+        rehash(currentCapacity); // compacts, and the old buckets take their keys with them
+    } else {
+        for (size_t i : freed) {
+            reclaimKey(buckets[i]);
+        }
+        maybeRebuildFilter();
+    }
+    return removed;
+}
+
+size_t HashTable::merge(const HashTable& other) {
+    if (&other == this) {
+        return 0;
+    }
+    Clock::time_point now = Clock::now();
+
+    // read only pass: where each of other's live entries already is in here
+    std::vector<size_t> found(other.currentCapacity, NOT_FOUND);
+    auto classify = [&]() {
+        std::atomic<size_t> fresh{0};
+        forChunks(other.currentCapacity, true, [&](size_t begin, size_t end) {
+            size_t local = 0;
+            for (size_t i = begin; i < end; ++i) {
+                const HashTableBucket& entry = other.buckets[i];
+                if (entry.type != BucketType::NORMAL || entry.expiresAt <= now) {
+                    continue;
+                }
+                found[i] = locate(entry.key);
+                local += (found[i] == NOT_FOUND);
+            }
+            fresh.fetch_add(local, std::memory_order_relaxed);
+        });
+        return fresh.load();
+    };
+    size_t fresh = classify();
+
+    // grow once for all of them, and find everything again if that moved it
+    size_t before = currentCapacity;
+    reserve(trueSize + fresh);
+    if (currentCapacity != before) {
+        fresh = classify();
+    }
+
+    // same claim flags as placeParallel, NORMAL buckets (including every one we overwrite) start out taken
+    std::unique_ptr<unsigned char[]> claims = std::make_unique_for_overwrite<unsigned char[]>(currentCapacity);
+    forChunks(currentCapacity, true, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            claims[i] = (buckets[i].type == BucketType::NORMAL) ? 1 : 0;
+        }
+    });
+
+    std::atomic<size_t> reused{0};
+    std::atomic<size_t> revived{0};
+    std::atomic<ptrdiff_t> expiringDelta{0};
+    std::atomic<size_t> longest{0}; // most taken buckets any new key stepped over
+    // new keys allocate, so with the (unsynchronized) arena the writes stay on this thread
+    forChunks(other.currentCapacity, !keyPool, [&](size_t begin, size_t end) {
+        size_t localReused = 0;
+        size_t localRevived = 0;
+        ptrdiff_t localExpiring = 0;
+        size_t localLongest = 0;
+        for (size_t i = begin; i < end; ++i) {
+            const HashTableBucket& entry = other.buckets[i];
+            if (entry.type != BucketType::NORMAL || entry.expiresAt <= now) {
+                continue;
+            }
+
+            size_t index = found[i];
+            if (index != NOT_FOUND) {
+                HashTableBucket& target = buckets[index];
+                localRevived += (target.expiresAt <= now); // wasn't visible, so it's new to callers
+                localExpiring += (entry.expiresAt != NO_EXPIRY) - (target.expiresAt != NO_EXPIRY);
+                target.value = entry.value;
+                target.expiresAt = entry.expiresAt;
+            } else {
+                // not in here, so the first free bucket on its probe path is the spot
+                size_t raw = rawHash(entry.key);
+                size_t home = raw % currentCapacity;
+                index = home;
+                size_t p = 0;
+                for (; std::atomic_ref<unsigned char>(claims[index]).exchange(1, std::memory_order_relaxed) != 0; ++p) {
+                    index = (home + offsets[p]) % currentCapacity;
+                }
+                localLongest = std::max(localLongest, p);
+
+                HashTableBucket& target = buckets[index];
+                localReused += (target.type == BucketType::EAR);
+                target.key = entry.key;
+                target.value = entry.value;
+                target.type = BucketType::NORMAL;
+                target.expiresAt = entry.expiresAt;
+                target.referenced = 0;
+                localExpiring += (entry.expiresAt != NO_EXPIRY);
+                if (filter) {
+                    filter->insertConcurrent(raw);
+                }
+            }
+
+            if (log) {
+                markDirtyConcurrent(index);
+                log->append(LogOp::PUT, entry.key, entry.value, toWallClock(entry.expiresAt));
+            }
+        }
+        reused.fetch_add(localReused, std::memory_order_relaxed);
+        revived.fetch_add(localRevived, std::memory_order_relaxed);
+        expiringDelta.fetch_add(localExpiring, std::memory_order_relaxed);
+        size_t seen = longest.load(std::memory_order_relaxed);
+        while (localLongest > seen && !longest.compare_exchange_weak(seen, localLongest, std::memory_order_relaxed)) {
+        }
+    });
+
+    trueSize += fresh;
+    tombstones -= reused.load();
+    expiringCount += expiringDelta.load();
+    if (log) {
+        writesSinceSnapshot += other.trueSize;
+    }
+    while (maxEntries != 0 && trueSize > maxEntries) {
+        evictOne(); // cache mode, same as setMaxSize
+    }
+    if (longest.load() > PROBE_LIMIT) {
+        reseed(); // same guard as insert
+    }
+    return fresh + revived.load();
+}
+
+void HashTable::placeSerial(BucketArray& old) {
+    // fresh table has no EAR and no duplicates, so the first ESS on the probe path is the spot
+    for (auto& bucket : old) {
+        if (bucket.type != BucketType::NORMAL) {
+            continue;
+        }
+
+        size_t raw = rawHash(bucket.key);
+        size_t home = raw % currentCapacity;
+        size_t index = home;
+        if (filter) {
+            filter->insert(raw);
+        }
+        for (size_t i = 0; buckets[index].type != BucketType::ESS; ++i) {
+            index = (home + offsets[i]) % currentCapacity;
+        }
+
+        buckets[index].key = std::move(bucket.key);
+        buckets[index].value = bucket.value;
+        buckets[index].type = BucketType::NORMAL;
+        buckets[index].expiresAt = bucket.expiresAt;
+        buckets[index].referenced = bucket.referenced;
+    }
+}
+
+void HashTable::placeParallel(BucketArray& old) {
+    // one claim flag per new bucket, whoever flips it 0 -> 1 owns the bucket
+    // so threads only ever write to buckets they claimed
+    // keys are moved between buckets sharing keyResource, so the (unsynchronized) arena is never touched here
+    // the flags come uninitialized and get zeroed on the pool too
+    std::unique_ptr<unsigned char[]> claims = std::make_unique_for_overwrite<unsigned char[]>(currentCapacity);
+    workers->parallelFor(currentCapacity, [&](size_t begin, size_t end) {
+        std::fill(claims.get() + begin, claims.get() + end, 0);
+    });
+
+    workers->parallelFor(old.size(), [&](size_t begin, size_t end) {
+        for (size_t b = begin; b < end; ++b) {
+            HashTableBucket& bucket = old[b];
+            if (bucket.type != BucketType::NORMAL) {
+                continue;
+            }
+
+            size_t raw = rawHash(bucket.key);
+            size_t home = raw % currentCapacity;
+            size_t index = home;
+            if (filter) {
+                filter->insertConcurrent(raw);
+            }
+            for (size_t i = 0; std::atomic_ref<unsigned char>(claims[index]).exchange(1, std::memory_order_relaxed) != 0; ++i) {
+                index = (home + offsets[i]) % currentCapacity;
+            }
+
+            buckets[index].key = std::move(bucket.key);
+            buckets[index].value = bucket.value;
+            buckets[index].type = BucketType::NORMAL;
+            buckets[index].expiresAt = bucket.expiresAt;
+            buckets[index].referenced = bucket.referenced;
+        }
+    });
 }
 
 bool HashTable::contains(const std::string& key) const {
     // index
-    size_t home = hash(key);
+    size_t raw = rawHash(key);
+    if (filterRejects(raw)) {
+        return false; // never inserted (or long gone)
+    }
+    size_t home = raw % currentCapacity;
     const HashTableBucket& bucket = buckets[home];
 
-    if (bucket.type == BucketType::NORMAL && bucket.key == key) {
-        // this is it
-        return true;
+    if (bucket.type == BucketType::NORMAL && bucket.key == std::string_view(key)) {
+        // this is it, unless its TTL ran out
+        touch(bucket);
+        return !expired(bucket);
     }
 
     if (bucket.type == BucketType::ESS) {
@@ -147,8 +766,9 @@ bool HashTable::contains(const std::string& key) const {
         const HashTableBucket& probe = buckets[index];
 
         if (probe.type == BucketType::NORMAL) {
-            if (probe.key == key) {
-                return true; // Normal and same key = true
+            if (probe.key == std::string_view(key)) {
+                touch(probe);
+                return !expired(probe); // Normal and same key = true, if still alive
             }
         }
 
@@ -161,16 +781,39 @@ bool HashTable::contains(const std::string& key) const {
 }
 
 std::optional<size_t> HashTable::get(const std::string& key) const {
+    return getHashed(key, rawHash(key));
+}
+
+const size_t* HashTable::find(const std::string& key) const {
+    return findHashed(key, rawHash(key));
+}
+
+std::optional<size_t> HashTable::getHashed(const std::string& key, size_t raw) const {
+    const size_t* value = findHashed(key, raw);
+    if (value == nullptr) {
+        return std::nullopt;
+    }
+    return *value;
+}
+
+const size_t* HashTable::findHashed(const std::string& key, size_t raw) const {
 	// get home index
-    size_t home = hash(key);
+    if (filterRejects(raw)) {
+        return nullptr;
+    }
+    size_t home = raw % currentCapacity;
     const HashTableBucket& bucket = buckets[home];
 
     if (bucket.type == BucketType::ESS) {
-		return std::nullopt; // because this bucket has never been used
+		return nullptr; // because this bucket has never been used
     }
 
-    if (bucket.type == BucketType::NORMAL && bucket.key == key) {
-    	return bucket.value; // this is it
+    if (bucket.type == BucketType::NORMAL && bucket.key == std::string_view(key)) {
+        if (expired(bucket)) {
+            return nullptr; // still here until swept, but not visible
+        }
+        touch(bucket);
+    	return &bucket.value; // this is it
     }
 
     for (size_t i = 0; i < offsets.size(); ++i) {
@@ -178,21 +821,33 @@ std::optional<size_t> HashTable::get(const std::string& key) const {
         const HashTableBucket& probe = buckets[index];
 
         if (probe.type == BucketType::ESS) {
-        	return std::nullopt; // empty
+        	return nullptr; // empty
         }
 
         if (probe.type == BucketType::NORMAL) {
-        	if (probe.key == key) {
-            	return probe.value; // key found
+        	if (probe.key == std::string_view(key)) {
+                if (expired(probe)) {
+                    return nullptr;
+                }
+                touch(probe);
+            	return &probe.value; // key found
         	}
         }
     }
-    return std::nullopt; // key not found
+    return nullptr; // key not found
 }
 
 bool HashTable::remove(const std::string& key) {
+    sweepStep();
+    snapshotStep();
+    maybeRebuildFilter();
+
   	// home index
-	size_t home = hash(key);
+    size_t raw = rawHash(key);
+    if (filterRejects(raw)) {
+        return false;
+    }
+	size_t home = raw % currentCapacity;
     HashTableBucket& bucket = buckets[home];
 
     // check home
@@ -200,10 +855,13 @@ bool HashTable::remove(const std::string& key) {
     	return false; // key shouldn't be here unless type assignments aren't working
     }
 
-    if (bucket.type == BucketType::NORMAL && bucket.key == key) {
-    	bucket.type = BucketType::EAR; // mark as removed from
-        trueSize--; // shrinks after loss
-        return true; // done
+    if (bucket.type == BucketType::NORMAL && bucket.key == std::string_view(key)) {
+        bool live = !expired(bucket); // an expired one goes either way, but wasn't really there
+    	reclaim(bucket); // mark as removed from
+        if (live && log) {
+            logWrite(LogOp::REMOVE, key, 0, NO_EXPIRY); // expired ones replay as gone anyway
+        }
+        return live; // done
     }
 
     for (size_t i = 0; i < offsets.size(); ++i) {
@@ -215,43 +873,104 @@ bool HashTable::remove(const std::string& key) {
         }
 
         if (probe.type == BucketType::NORMAL) {
-        	if (probe.key == key) {
-                  probe.type = BucketType::EAR; // removal
-                  trueSize--; // shrinks
-                  return true; // done
+        	if (probe.key == std::string_view(key)) {
+                  bool live = !expired(probe);
+                  reclaim(probe); // removal
+                  if (live && log) {
+                      logWrite(LogOp::REMOVE, key, 0, NO_EXPIRY);
+                  }
+                  return live; // done
         	}
         }
     }
     return false; // not found
 }
 
-size_t& HashTable::operator[](const std::string& key) {
+size_t* HashTable::findForUpdate(const std::string& key) {
+    sweepStep();
+
   	// home index again
-	size_t home = hash(key);
+    size_t raw = rawHash(key);
+    if (filterRejects(raw)) {
+        return nullptr;
+    }
+	size_t home = raw % currentCapacity;
     HashTableBucket& bucket = buckets[home];
 
     // check home again
-    if (bucket.type == BucketType::NORMAL && bucket.key == key) {
-    	return bucket.value;
+    if (bucket.type == BucketType::NORMAL && bucket.key == std::string_view(key)) {
+        if (expired(bucket)) {
+            reclaim(bucket);
+            return nullptr;
+        }
+        touch(bucket);
+        if (log) {
+            logTouch(home);
+        }
+    	return &bucket.value;
     }
 
     for (size_t i = 0; i < offsets.size(); ++i) {
     	size_t index = (home + offsets[i]) % currentCapacity;
         HashTableBucket& probe = buckets[index];
 
-        if (probe.type == BucketType::NORMAL && probe.key == key) {
-        	return probe.value;
+        if (probe.type == BucketType::NORMAL && probe.key == std::string_view(key)) {
+            if (expired(probe)) {
+                reclaim(probe);
+                break;
+            }
+            touch(probe);
+            if (log) {
+                logTouch(index);
+            }
+        	return &probe.value;
         }
     }
-    throw std::runtime_error("Key not found");
+    return nullptr;
+}
+
+size_t& HashTable::operator[](const std::string& key) {
+    size_t* value = findForUpdate(key);
+    if (value == nullptr) {
+        throw std::runtime_error("Key not found");
+    }
+    return *value;
+}
+
+bool HashTable::expire(const std::string& key, Clock::duration ttl) {
+    size_t home = hash(key);
+    for (size_t i = 0; i <= offsets.size(); ++i) {
+        size_t index = (i == 0) ? home : (home + offsets[i - 1]) % currentCapacity;
+        HashTableBucket& probe = buckets[index];
+
+        if (probe.type == BucketType::ESS) {
+            return false; // never got this far
+        }
+        if (probe.type == BucketType::NORMAL && probe.key == std::string_view(key)) {
+            if (expired(probe)) {
+                reclaim(probe);
+                return false;
+            }
+            if (probe.expiresAt == NO_EXPIRY) {
+                expiringCount++;
+            }
+            probe.expiresAt = Clock::now() + ttl;
+            if (log) {
+                markDirty(index);
+                logWrite(LogOp::PUT, key, probe.value, probe.expiresAt);
+            }
+            return true;
+        }
+    }
+    return false;
 }
 
 std::vector<std::string> HashTable::keys() const {
 	std::vector<std::string> keys; // new vector for keys
     // loop through the buckets and add all keys to new vector if type is normal (has a key)
     for (const auto& bucket : buckets) {
-    	if (bucket.type == BucketType::NORMAL) {
-        	keys.push_back(bucket.key);
+    	if (bucket.type == BucketType::NORMAL && !expired(bucket)) {
+        	keys.emplace_back(bucket.key);
     	}
     }
     return keys; // return vector of keys
@@ -261,13 +980,414 @@ size_t HashTable::capacity() const {
 	return currentCapacity; // simple enough, returns the capacity member var
 }
 
+void HashTable::clear() {
+    // destroy the keys first so their bytes are back in the arena before it lets go of everything
+    buckets.clear();
+    if (keyPool) {
+        keyPool->pool.release();
+    }
+    makeBuckets();
+    trueSize = 0;
+    tombstones = 0;
+    expiringCount = 0;
+    sweepCursor = 0;
+    clockHand = 0;
+    if (filter) {
+        filter->reset(currentCapacity / 2);
+        filterStale = 0;
+    }
+    if (log) {
+        touchedBuckets.clear(); // whatever they were set to is gone now
+        std::fill(dirtyRanges.begin(), dirtyRanges.end(), 1);
+        logWrite(LogOp::CLEAR, {}, 0, NO_EXPIRY);
+    }
+}
+
+FrozenHashTable HashTable::freeze() const {
+    std::vector<std::pair<std::string, size_t>> entries;
+    entries.reserve(trueSize);
+    for (const auto& bucket : buckets) {
+        // a frozen table has no TTLs, only what's alive right now goes in
+        if (bucket.type == BucketType::NORMAL && !expired(bucket)) {
+            entries.emplace_back(std::string(bucket.key), bucket.value);
+        }
+    }
+    return FrozenHashTable(std::move(entries));
+}
+
+void HashTable::reclaimKey(HashTableBucket& bucket) {
+    // only worth it with the arena, the pool hands the bytes to the next key that needs them
+    // plain heap keys just keep their buffer for whoever lands in this bucket next
+    if (keyPool) {
+        // swap, not assign - assigning an empty string keeps the old buffer
+        // and with the key's own allocator, shrink_to_fit reclaims old pool keys after keyResource moved on
+        std::pmr::string(bucket.key.get_allocator()).swap(bucket.key);
+    }
+}
+
+void HashTable::reclaim(HashTableBucket& bucket) {
+    markDirty(static_cast<size_t>(&bucket - buckets.data()));
+    bucket.type = BucketType::EAR;
+    if (bucket.expiresAt != NO_EXPIRY) {
+        expiringCount--;
+        bucket.expiresAt = NO_EXPIRY;
+    }
+    reclaimKey(bucket);
+    trueSize--;
+    tombstones++;
+    if (filter) {
+        filterStale++; // still in the filter, just a false positive from now on
+    }
+}
+
+bool HashTable::expired(const HashTableBucket& bucket) const {
+    return bucket.expiresAt != NO_EXPIRY && bucket.expiresAt <= Clock::now();
+}
+
+void HashTable::sweepStep() {
+    if (expiringCount > 0) {
+        sweep(SWEEP_STEP);
+    }
+}
+
+size_t HashTable::sweep(size_t maxBuckets) {
+    size_t reclaimed = 0;
+    Clock::time_point now = Clock::now(); // one clock read per step
+    maxBuckets = std::min(maxBuckets, currentCapacity);
+    for (size_t i = 0; i < maxBuckets && expiringCount > 0; ++i) {
+        HashTableBucket& bucket = buckets[sweepCursor];
+        if (bucket.type == BucketType::NORMAL && bucket.expiresAt <= now) {
+            reclaim(bucket);
+            reclaimed++;
+        }
+        sweepCursor = (sweepCursor + 1) % currentCapacity;
+    }
+    return reclaimed;
+}
+
+void HashTable::setMaxSize(size_t maxEntries) {
+    this->maxEntries = maxEntries;
+    while (maxEntries != 0 && trueSize > maxEntries) {
+        evictOne();
+    }
+}
+
+size_t HashTable::maxSize() const {
+    return maxEntries;
+}
+
+HashTableStats HashTable::stats() const {
+    HashTableStats result;
+    result.tombstones = tombstones;
+    result.expiring = expiringCount;
+    result.evictions = evictions;
+    result.reseeds = reseeds;
+    return result;
+}
+
+HashTableMemory HashTable::memory_usage() const {
+    HashTableMemory result;
+    constexpr size_t BUCKET = sizeof(HashTableBucket);
+    // what the fields take with nothing between or after them
+    constexpr size_t FIELDS = sizeof(std::pmr::string) + sizeof(size_t) + sizeof(BucketType)
+                              + sizeof(Clock::time_point) + sizeof(unsigned char);
+    const size_t inlineCapacity = std::pmr::string().capacity(); // longest key that needs no heap
+    const bool pooled = keyPool != nullptr;
+    size_t poolBlocks = 0; // what the key buffers take out of the arena, size class rounding included
+
+    for (const auto& bucket : buckets) {
+        size_t& counter = (bucket.type == BucketType::EAR) ? result.tombstones : result.keyHeap;
+        if (bucket.type == BucketType::EAR) {
+            result.tombstones += BUCKET;
+        } else {
+            result.buckets += BUCKET;
+        }
+        if (bucket.key.capacity() > inlineCapacity) {
+            size_t asked = bucket.key.capacity() + 1; // terminator
+            counter += asked;
+            result.slack += allocationSize(asked, pooled) - asked;
+            poolBlocks += allocationSize(asked, pooled);
+        }
+    }
+    result.bucketPadding = buckets.size() * (BUCKET - FIELDS);
+    if (pooled && keyPool->counter.held() > poolBlocks) {
+        result.keyPoolFree = keyPool->counter.held() - poolBlocks;
+    }
+
+    result.sideTables = offsets.size() * sizeof(size_t);
+    if (filter) {
+        result.sideTables += filter->bytes();
+    }
+    result.sideTables += dirtyRanges.capacity() + touchedBuckets.capacity() * sizeof(size_t);
+
+    result.slack += (buckets.capacity() - buckets.size()) * BUCKET;
+    result.slack += (offsets.capacity() - offsets.size()) * sizeof(size_t);
+
+    result.total = sizeof(HashTable) + result.buckets + result.sideTables + result.keyHeap
+                   + result.tombstones + result.slack + result.keyPoolFree;
+    return result;
+}
+
+void HashTable::shrink_to_fit() {
+    // keys have to move to a fresh pool, or the old one keeps every block it ever handed out
+    std::unique_ptr<KeyArena> oldPool;
+    if (keyPool) {
+        oldPool = std::move(keyPool);
+        keyPool = std::make_unique<KeyArena>(oldPool->counter.upstreamResource());
+        keyResource = &keyPool->pool;
+    }
+
+    // with the arena, placement allocates from the new pool, which isn't thread safe, so that one is serial
+    ThreadPool* pool = workers;
+    if (keyPool) {
+        workers = nullptr;
+    }
+    rehash(8); // rehash itself raises this to what keeps alpha under .5
+    workers = pool;
+
+    offsets.shrink_to_fit();
+    dirtyRanges.shrink_to_fit();
+    touchedBuckets.shrink_to_fit();
+    // oldPool goes last, the old buckets holding its keys are already gone
+}
+
+void HashTable::touch(const HashTableBucket& bucket) const {
+    // only cache mode reads the bit; checking first keeps hits from dirtying the cache line every time
+    if (maxEntries != 0) {
+        std::atomic_ref<unsigned char> bit(bucket.referenced);
+        if (bit.load(std::memory_order_relaxed) == 0) {
+            bit.store(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void HashTable::evictOne() {
+    // every referenced entry gets its bit cleared on the first pass, so two laps always find one
+    for (size_t step = 0; step < 2 * currentCapacity && trueSize > 0; ++step) {
+        HashTableBucket& bucket = buckets[clockHand];
+        clockHand = (clockHand + 1) % currentCapacity;
+
+        if (bucket.type != BucketType::NORMAL) {
+            continue;
+        }
+        if (bucket.referenced != 0 && !expired(bucket)) {
+            bucket.referenced = 0; // second chance
+            continue;
+        }
+        // unreferenced, or already expired - either way it goes
+        if (log) {
+            logWrite(LogOp::REMOVE, bucket.key, 0, NO_EXPIRY);
+        }
+        reclaim(bucket);
+        evictions++;
+        return;
+    }
+}
+
+void HashTable::setFilter(bool enabled) {
+    if (!enabled) {
+        filter.reset();
+        filterStale = 0;
+        return;
+    }
+    if (!filter) {
+        filter = std::make_unique<BlockedBloomFilter>();
+        rebuildFilter();
+    }
+}
+
+bool HashTable::hasFilter() const {
+    return filter != nullptr;
+}
+
+void HashTable::setHardened(bool enabled) {
+    if (enabled == keyed) {
+        return;
+    }
+    if (enabled) {
+        reseed();
+        reseeds--; // asked for, not forced
+    } else {
+        keyed = false;
+        rehash(currentCapacity); // back to std::hash homes
+    }
+}
+
+bool HashTable::isHardened() const {
+    return keyed;
+}
+
+void HashTable::reseed() {
+    std::random_device rd;
+    hashKey.k0 = (static_cast<uint64_t>(rd()) << 32) | rd();
+    hashKey.k1 = (static_cast<uint64_t>(rd()) << 32) | rd();
+    keyed = true;
+    reseeds++;
+    rehash(currentCapacity); // every home bucket moved
+}
+
+bool HashTable::filterRejects(size_t raw) const {
+    return filter && !filter->mayContain(raw);
+}
+
+void HashTable::rebuildFilter() {
+    // sized for the most this capacity holds before the next resize
+    filter->reset(currentCapacity / 2);
+    for (const auto& bucket : buckets) {
+        if (bucket.type == BucketType::NORMAL) {
+            filter->insert(rawHash(bucket.key));
+        }
+    }
+    filterStale = 0;
+}
+
+void HashTable::maybeRebuildFilter() {
+    // stale keys only cost false positives, wait until they're a real share before paying for a scan
+    if (filter && filterStale > 64 && filterStale > trueSize / 2) {
+        rebuildFilter();
+    }
+}
+
+void HashTable::enableLog(const std::string& dir) {
+    auto opened = std::make_unique<HashTableLog>(dir);
+    if (!opened->empty()) {
+        throw std::runtime_error("Log directory already in use");
+    }
+    log = std::move(opened);
+    newLayout();
+    if (trueSize > 0) {
+        snapshot(); // nothing before now is in the log
+    }
+}
+
+bool HashTable::hasLog() const {
+    return log != nullptr;
+}
+
+void HashTable::syncLog() {
+    if (log) {
+        settleTouched();
+        log->sync();
+    }
+}
+
+HashTable HashTable::recover(const std::string& dir) {
+    auto opened = std::make_unique<HashTableLog>(dir);
+    HashTable table(std::max<size_t>(8, opened->capacityHint()));
+    // no log attached yet, so replaying doesn't log everything a second time
+    opened->replay([&table](const LogRecord& record) { table.apply(record); });
+    table.log = std::move(opened);
+    table.newLayout();
+    return table;
+}
+
+size_t HashTable::snapshot(size_t maxRanges) {
+    if (!log) {
+        return 0;
+    }
+    settleTouched(); // the log has to be at least as new as what we copy
+
+    size_t written = 0;
+    for (size_t n = 0; n < dirtyRanges.size() && (maxRanges == 0 || written < maxRanges); ++n) {
+        size_t range = snapshotCursor;
+        snapshotCursor = (snapshotCursor + 1) % dirtyRanges.size();
+        if (dirtyRanges[range] == 0) {
+            continue;
+        }
+
+        // copying is all that happens here, the writer thread does the file
+        std::string bytes;
+        size_t end = std::min(currentCapacity, (range + 1) * SNAPSHOT_RANGE);
+        for (size_t i = range * SNAPSHOT_RANGE; i < end; ++i) {
+            const HashTableBucket& bucket = buckets[i];
+            if (bucket.type == BucketType::NORMAL && !expired(bucket)) {
+                HashTableLog::encode(bytes, LogOp::PUT, bucket.key, bucket.value, toWallClock(bucket.expiresAt));
+            }
+        }
+        log->writeSegment(snapshotGeneration, range, dirtyRanges.size(), currentCapacity, std::move(bytes));
+        dirtyRanges[range] = 0;
+        written++;
+    }
+    return written;
+}
+
+void HashTable::logWrite(LogOp op, std::string_view key, size_t value, Clock::time_point expiresAt) {
+    log->append(op, key, value, toWallClock(expiresAt));
+    writesSinceSnapshot++;
+}
+
+void HashTable::markDirty(size_t index) {
+    if (log) {
+        dirtyRanges[index / SNAPSHOT_RANGE] = 1;
+    }
+}
+
+void HashTable::markDirtyConcurrent(size_t index) {
+    std::atomic_ref<unsigned char>(dirtyRanges[index / SNAPSHOT_RANGE]).store(1, std::memory_order_relaxed);
+}
+
+void HashTable::logTouch(size_t index) {
+    markDirty(index);
+    // settle the older ones first, this one's new value hasn't been written yet
+    if (touchedBuckets.size() >= LOG_TOUCH_BATCH) {
+        settleTouched();
+    }
+    touchedBuckets.push_back(index);
+}
+
+void HashTable::settleTouched() {
+    for (size_t index : touchedBuckets) {
+        // log whatever is there now - a removed key already has its REMOVE, an expired one replays
+        // as gone by itself, and if another key moved in its current value is just as true
+        const HashTableBucket& bucket = buckets[index];
+        if (bucket.type == BucketType::NORMAL && !expired(bucket)) {
+            log->append(LogOp::PUT, bucket.key, bucket.value, toWallClock(bucket.expiresAt));
+        }
+    }
+    touchedBuckets.clear();
+}
+
+void HashTable::newLayout() {
+    snapshotGeneration = log->newGeneration();
+    dirtyRanges.assign((currentCapacity + SNAPSHOT_RANGE - 1) / SNAPSHOT_RANGE, 1);
+    snapshotCursor = 0;
+}
+
+void HashTable::snapshotStep() {
+    // at the start of a write, so what gets copied matches everything logged so far
+    if (log && writesSinceSnapshot >= SNAPSHOT_EVERY) {
+        writesSinceSnapshot = 0;
+        snapshot(1);
+    }
+}
+
+void HashTable::apply(const LogRecord& record) {
+    std::string key(record.key);
+    switch (record.op) {
+        case LogOp::PUT:
+            remove(key);
+            if (record.deadline == 0) {
+                insertUntil(key, record.value, NO_EXPIRY);
+            } else if (Clock::time_point at = fromWallClock(record.deadline); at > Clock::now()) {
+                insertUntil(key, record.value, at);
+            }
+            break;
+        case LogOp::REMOVE:
+            remove(key);
+            break;
+        case LogOp::CLEAR:
+            clear();
+            break;
+    }
+}
+
 std::ostream& operator<<(std::ostream& os, const HashTable& t) {
   	// loop through the buckets
 	for (size_t i = 0; i < t.capacity(); ++i) {
     	const HashTableBucket& bucket = t.buckets[i];
 
         // check bucket type = normal?
-        if (bucket.type == BucketType::NORMAL) {
+        if (bucket.type == BucketType::NORMAL && !t.expired(bucket)) {
         	os << "Bucket " << i << ": <" << bucket.key << ", " << bucket.value << ">" << std::endl;
         }
 	}
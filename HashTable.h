@@ -2,34 +2,153 @@
  * HashTable.h
  */
 
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <chrono>
+#include <coroutine>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <memory_resource>
+#include <new>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 #include <optional>
 #include <ostream>
 
-// Create an enum for the bucket type
-// NORMAL - not empty,
-// ESS - empty since start,
-// EAR - empty after removal
-enum class BucketType {
-    NORMAL, ESS, EAR
-};
+#include "BlockedBloomFilter.h"
+#include "BucketType.h"
+#include "HashTableLog.h"
+#include "SipHash.h"
+
+class ThreadPool;
+class FrozenHashTable;
+class LookupScheduler;
 
 class HashTable;
 
 // create the hash table buckets
-class HashTableBucket {
+// aligned to a cache line, and DeferredAllocator asks for alignof, so every probe step touches exactly one line
+class alignas(64) HashTableBucket {
     friend class HashTable;
     friend std::ostream& operator<<(std::ostream& os, const HashTable& t);
     public:
         HashTableBucket () {
             type = BucketType::ESS; // default type
         }
+        // key bytes come from keyResource instead of the default heap
+        explicit HashTableBucket (std::pmr::memory_resource* keyResource) : key(keyResource) {
+            type = BucketType::ESS;
+        }
     private:
-        std::string key;
+        std::pmr::string key;
         size_t value;
         BucketType type;
+        // CLOCK reference bit, set by lookups (through atomic_ref so const readers don't race)
+        // right after type so it sits in type's padding and the fields still fit in 64 bytes
+        mutable unsigned char referenced = 0;
+        // when a TTL entry stops being visible, max() for entries that never expire
+        std::chrono::steady_clock::time_point expiresAt = std::chrono::steady_clock::time_point::max();
+};
+
+// counters for watching a table from the outside
+struct HashTableStats {
+    size_t tombstones = 0; // EAR buckets right now
+    size_t expiring = 0; // entries with a TTL
+    size_t evictions = 0; // entries pushed out by the size limit so far
+    size_t reseeds = 0; // times an insert probed too far and the table rehashed with a new hash key
+};
+
+// where a table's bytes go, everything but bucketPadding adds up to total without overlap
+// heap numbers count what was asked for plus an estimate of the allocator's rounding (slack)
+struct HashTableMemory {
+    size_t buckets = 0; // bucket array slots that are NORMAL or ESS, padding included
+    size_t bucketPadding = 0; // how much of buckets and tombstones is alignment padding, already counted there
+    size_t sideTables = 0; // probe offsets, Bloom filter, log bookkeeping
+    size_t keyHeap = 0; // live keys too long for the string's inline buffer
+    size_t tombstones = 0; // EAR buckets plus whatever key buffers they still hold
+    size_t slack = 0; // reserved but unused vector capacity and allocator rounding on key buffers
+    // key arena only: what the pool holds from upstream minus the key blocks above, i.e. freed keys
+    // and spare chunks - roughly what shrink_to_fit hands back (an estimate, the pool's size classes are guessed)
+    size_t keyPoolFree = 0;
+    size_t total = 0; // all of the above but bucketPadding, plus the HashTable object itself
+};
+
+// pass-through memory_resource that keeps count of the bytes currently allocated through it
+class CountingResource : public std::pmr::memory_resource {
+    public:
+        explicit CountingResource(std::pmr::memory_resource* upstream) noexcept : upstream(upstream) {}
+
+        std::pmr::memory_resource* upstreamResource() const noexcept {
+            return upstream;
+        }
+        size_t held() const noexcept {
+            return bytes;
+        }
+
+    private:
+        std::pmr::memory_resource* upstream;
+        size_t bytes = 0;
+
+        void* do_allocate(size_t n, size_t alignment) override {
+            void* p = upstream->allocate(n, alignment);
+            bytes += n;
+            return p;
+        }
+        void do_deallocate(void* p, size_t n, size_t alignment) override {
+            upstream->deallocate(p, n, alignment);
+            bytes -= n;
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+};
+
+// allocator for the bucket and offset arrays: memory from a memory_resource like polymorphic_allocator,
+// but a resize() doesn't construct the new elements - makeBuckets/shuffleOffsets fill them in right after,
+// spread over the thread pool for big tables, instead of a serial pass over the whole array first
+template <typename T>
+class DeferredAllocator {
+    public:
+        using value_type = T;
+
+        DeferredAllocator(std::pmr::memory_resource* resource) noexcept : upstream(resource) {}
+        template <typename U>
+        DeferredAllocator(const DeferredAllocator<U>& other) noexcept : upstream(other.resource()) {}
+
+        T* allocate(size_t n) {
+            return static_cast<T*>(upstream->allocate(n * sizeof(T), alignof(T)));
+        }
+        void deallocate(T* p, size_t n) noexcept {
+            upstream->deallocate(p, n * sizeof(T), alignof(T));
+        }
+
+        // left for the caller to construct
+        template <typename U>
+        void construct(U*) noexcept {}
+        template <typename U, typename... Args>
+        void construct(U* p, Args&&... args) {
+            ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+        }
+
+        std::pmr::memory_resource* resource() const noexcept {
+            return upstream;
+        }
+
+        // goes wherever the array goes, HashTable moves its arrays and their resources together
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        template <typename U>
+        bool operator==(const DeferredAllocator<U>& other) const noexcept {
+            return upstream == other.resource() || upstream->is_equal(*other.resource());
+        }
+
+    private:
+        std::pmr::memory_resource* upstream;
 };
 
 // create the hash table class
@@ -37,35 +156,249 @@ class HashTable {
     public:
         // constructor that sets size; default 8
         HashTable(size_t initCapacity = 8);
+        // buckets and offsets allocate from upstream, keys from a pool arena on top of upstream
+        // key memory is recycled when buckets become EAR and handed back in bulk by clear() or the destructor
+        // bucketResource (e.g. a HugePageResource) takes over the bucket and offset arrays if given
+        HashTable(size_t initCapacity, std::pmr::memory_resource* upstream,
+                  std::pmr::memory_resource* bucketResource = nullptr);
+
+        // a copy gets its own key arena (on the same upstream) when other has one, and no log
+        // same capacity and offsets, so every entry lands in the bucket it has in other
+        HashTable(const HashTable& other);
+        HashTable& operator=(const HashTable& other);
+        // moves take the arena along with the buckets holding its keys
+        HashTable(HashTable&&) = default;
+        HashTable& operator=(HashTable&& other) noexcept;
+        // hands anything not logged yet to the log, which writes it out before closing
+        ~HashTable();
 
         friend std::ostream& operator<<(std::ostream& os, const HashTable& ht);
 
+        using Clock = std::chrono::steady_clock;
+
         bool insert(const std::string& key, const size_t& value);
+        // entry disappears ttl from now; an expired key can be inserted again right away
+        bool insert(const std::string& key, const size_t& value, Clock::duration ttl);
+        // (re)set the TTL of a live key, false if it isn't there
+        bool expire(const std::string& key, Clock::duration ttl);
 
+        // expired entries are invisible right away, but still counted until the sweeper reclaims them
         size_t size() const;
         double alpha() const;
 
         bool contains(const std::string& key) const;
 
         std::optional<size_t> get(const std::string& key) const;
+        // the value in its bucket, nullptr if key isn't there - good until the next insert, remove or rehash
+        // a lookup like get(), nothing is changed or logged
+        const size_t* find(const std::string& key) const;
+        // operator[] without the throw: writable, and logged (and sweeping) the same way
+        size_t* findForUpdate(const std::string& key);
         bool remove(const std::string& key);
 
+        // co_await-able get() for LookupTask coroutines (HashTableAsync.h)
+        // suspending prefetches the home bucket and queues the coroutine on the scheduler, so many
+        // lookups in flight overlap their cache misses; key has to live until the co_await is done
+        struct AsyncGet {
+            const HashTable& table;
+            const std::string& key;
+            size_t raw;
+            LookupScheduler& scheduler;
+
+            bool await_ready() const;
+            void await_suspend(std::coroutine_handle<> handle);
+            std::optional<size_t> await_resume() const;
+        };
+        AsyncGet get_async(const std::string& key, LookupScheduler& scheduler) const;
+
         size_t& operator[](const std::string& key);
 
         std::vector<std::string> keys() const;
 
         size_t capacity() const;
 
+        // remove everything, keeps the capacity, releases arena memory back to upstream
+        void clear();
+
+        // read only copy for tables that are done changing: one slot per lookup, ~99% of slots in use
+        FrozenHashTable freeze() const;
+
+        // rebuild the table with at least newCapacity buckets
+        // never goes below what keeps alpha under .5 for the current size
+        void rehash(size_t newCapacity);
+        // grow ahead of time so count entries fit without another resize
+        void reserve(size_t count);
+
+        // pool to spread rehashes and the bulk operations below over, nullptr (default) keeps everything on the calling thread
+        void setThreadPool(ThreadPool* pool);
 
+        // bulk operations, each one scan of the bucket array in chunks spread over the thread pool
+        // with a pool fn/pred get called from several threads at once, so they have to be thread safe
+
+        // fn(key, value) for every live entry, value can be changed in place
+        void for_each(const std::function<void(std::string_view, size_t&)>& fn);
+        // remove every live entry pred(key, value) is true for, returns how many
+        // they're all tombstoned in the scan, then one same size rehash if that left too many tombstones
+        size_t erase_if(const std::function<bool(std::string_view, size_t)>& pred);
+        // put every live entry of other in here, other's value (and TTL) wins for keys in both; returns how many were new
+        // finds all of other's keys first (read only), grows once, then writes everything in parallel
+        size_t merge(const HashTable& other);
+
+        // bounded cache mode: once maxEntries are in, each new insert evicts one entry picked by CLOCK
+        // (get/contains/operator[] hits set a reference bit, the hand skips and clears referenced entries)
+        // 0 turns the limit off; lowering it below size() evicts right away
+        void setMaxSize(size_t maxEntries);
+        size_t maxSize() const;
+
+        HashTableStats stats() const;
+
+        // byte breakdown for capacity planning, walks every bucket so O(capacity)
+        HashTableMemory memory_usage() const;
+        // rebuild at the smallest capacity that keeps alpha under .5 (never below 8), dropping tombstones
+        // with the key arena the keys are copied into a fresh pool so freed key memory goes back upstream too
+        void shrink_to_fit();
+
+        // Bloom filter in front of the buckets: a miss usually costs one cache line instead of a probe walk
+        // rebuilt on every rehash, removed keys stay in it until enough pile up to rebuild
+        void setFilter(bool enabled);
+        bool hasFilter() const;
+
+        // hardened mode for keys from untrusted clients: hash with SipHash under a random per table key
+        // instead of std::hash, so nobody outside can line keys up on one probe sequence
+        // whatever the mode, an insert that has to step over more than PROBE_LIMIT live entries switches to
+        // hardened mode with a fresh key and rehashes (counted in stats().reseeds)
+        void setHardened(bool enabled);
+        bool isHardened() const;
+        static constexpr size_t PROBE_LIMIT = 32;
+
+        // look at the next maxBuckets buckets (wrapping around) and turn expired entries into EAR
+        // insert, remove and operator[] already do a small step of this, returns how many were reclaimed
+        size_t sweep(size_t maxBuckets);
+
+        // durability: from now on insert/remove/expire/clear/evictions go to an append only log in dir,
+        // written and fdatasync'd in batches by a background thread (writes don't wait for the disk)
+        // dirty bucket ranges are snapshotted a range at a time as writes go by, so the log can be cut short
+        // values changed through an operator[] reference get logged at the next syncLog()/snapshot(), every
+        // 256 operator[] calls or on destruction - don't keep the reference around past that
+        // throws if dir already holds a log, that's what recover() is for
+        void enableLog(const std::string& dir);
+        bool hasLog() const;
+        // block until every write so far is on disk
+        void syncLog();
+        // hand up to maxRanges dirty bucket ranges to the log writer (0 = all of them), returns how many
+        size_t snapshot(size_t maxRanges = 0);
+        // table rebuilt from the last snapshot in dir plus the log after it, and logging to dir again
+        static HashTable recover(const std::string& dir);
 
     private:
-        std::vector<HashTableBucket> buckets;
+        // the key arena: a pool whose upstream is counted, so memory_usage can see the pool's free blocks
+        struct KeyArena {
+            explicit KeyArena(std::pmr::memory_resource* upstream) : counter(upstream), pool(&counter) {}
+            CountingResource counter; // before pool, which hands everything back to it on the way out
+            std::pmr::unsynchronized_pool_resource pool;
+        };
+
+        // declared before the vectors so the arena outlives every key in them
+        std::unique_ptr<KeyArena> keyPool; // only with the upstream constructor
+        std::pmr::memory_resource* resource; // buckets and offsets
+        std::pmr::memory_resource* keyResource; // key bytes
+
+        using BucketArray = std::vector<HashTableBucket, DeferredAllocator<HashTableBucket>>;
+
+        BucketArray buckets;
         size_t trueSize; // number of things in it
         size_t currentCapacity; // number of things it could have
-        std::vector<size_t> offsets; // probing offsets
+        std::vector<size_t, DeferredAllocator<size_t>> offsets; // probing offsets
+        ThreadPool* workers = nullptr; // not owned
+        size_t tombstones = 0; // EAR buckets, they make probes longer so enough of them forces a rehash
+        size_t expiringCount = 0; // NORMAL buckets with a TTL, sweeping is skipped while this is 0
+        size_t sweepCursor = 0; // where the next sweep step starts
+        size_t maxEntries = 0; // 0 = no limit
+        size_t clockHand = 0; // next bucket CLOCK looks at
+        size_t evictions = 0;
+        std::unique_ptr<BlockedBloomFilter> filter; // nullptr unless setFilter(true)
+        size_t filterStale = 0; // keys removed since the filter was last built
+        bool keyed = false; // hashing with SipHash under hashKey
+        SipKey hashKey;
+        size_t reseeds = 0;
+        std::unique_ptr<HashTableLog> log; // nullptr unless enableLog/recover
+        uint64_t snapshotGeneration = 0; // log generation of the current bucket layout
+        std::vector<unsigned char> dirtyRanges; // one flag per SNAPSHOT_RANGE buckets, set when one changes
+        size_t snapshotCursor = 0; // range the next snapshot looks at first
+        size_t writesSinceSnapshot = 0;
+        std::vector<size_t> touchedBuckets; // operator[] hits whose values aren't logged yet
+
+        // tables smaller than this rehash and scan serially, handing off to threads costs more than it saves
+        static constexpr size_t PARALLEL_REHASH_MIN = 1 << 15;
+        // buckets the sweeper looks at per insert/remove/operator[]
+        static constexpr size_t SWEEP_STEP = 8;
+        static constexpr Clock::time_point NO_EXPIRY = Clock::time_point::max();
+        // buckets per snapshot segment
+        static constexpr size_t SNAPSHOT_RANGE = 1 << 14;
+        // logged writes between the automatic one range snapshots
+        static constexpr size_t SNAPSHOT_EVERY = 1 << 12;
+        // operator[] hits kept before their values are logged
+        static constexpr size_t LOG_TOUCH_BATCH = 256;
 
         // hash function to prevent excessive repetition in every other method
-        size_t hash(const std::string& key) const;
+        size_t hash(std::string_view key) const;
+        // full hash before the modulo, what the filter is keyed on
+        size_t rawHash(std::string_view key) const;
+        // get() with the hash already done
+        std::optional<size_t> getHashed(const std::string& key, size_t raw) const;
+        const size_t* findHashed(const std::string& key, size_t raw) const;
+        // filter says key is definitely not here
+        bool filterRejects(size_t raw) const;
+        // refill the filter from the live entries
+        void rebuildFilter();
+        // rebuild once removed keys are a big enough share of the filter
+        void maybeRebuildFilter();
         // resizer - double when load factor >= .5
         void resize();
-};
\ No newline at end of file
+        // fill the (empty) buckets vector with currentCapacity ESS buckets whose keys use keyResource
+        void makeBuckets();
+        // fill offsets with a fresh random permutation of 1..capacity-1
+        void shuffleOffsets();
+        // move the NORMAL buckets of old into the (empty) buckets vector
+        void placeSerial(BucketArray& old);
+        void placeParallel(BucketArray& old);
+        // give a removed key's bytes back to the arena
+        void reclaimKey(HashTableBucket& bucket);
+        // NORMAL -> EAR with all the bookkeeping (size, tombstones, TTL count, arena)
+        void reclaim(HashTableBucket& bucket);
+        // past its TTL, only reads the clock for entries that have one
+        bool expired(const HashTableBucket& bucket) const;
+        // the bounded sweep insert/remove/operator[] do, free when nothing has a TTL
+        void sweepStep();
+        // lookup hit, remember it for CLOCK
+        void touch(const HashTableBucket& bucket) const;
+        // run the CLOCK hand until one entry is gone
+        void evictOne();
+        // append a record for a change that has already happened
+        void logWrite(LogOp op, std::string_view key, size_t value, Clock::time_point expiresAt);
+        // bucket index changed since its range was last snapshotted
+        void markDirty(size_t index);
+        // operator[] handed out a reference to bucket index
+        void logTouch(size_t index);
+        // log what's in touchedBuckets now, has to happen before a rehash moves things
+        void settleTouched();
+        // new generation with every range dirty, after a rehash or when the log is attached
+        void newLayout();
+        // the snapshot insert/remove do once SNAPSHOT_EVERY writes went by
+        void snapshotStep();
+        // replay one record during recover()
+        void apply(const LogRecord& record);
+        // fn over [0, count) in chunks, on the pool if parallel, there is one and count is big enough
+        void forChunks(size_t count, bool parallel, const std::function<void(size_t, size_t)>& fn) const;
+        // index of the NORMAL bucket holding key (expired or not), NOT_FOUND if there isn't one
+        size_t locate(std::string_view key) const;
+        static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+        // markDirty for the bulk operations, safe from several threads
+        void markDirtyConcurrent(size_t index);
+        // new random hashKey, keyed mode on, rehash everything where it goes now
+        void reseed();
+        // shared by both inserts
+        bool insertUntil(const std::string& key, const size_t& value, Clock::time_point expiresAt);
+};
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * HashTableAsync.cpp
+ */
+
+#include "HashTableAsync.h"
+#include "HashTable.h"
+
+LookupScheduler::~LookupScheduler() {
+    // anything still suspended is ours to clean up
+    for (auto handle : ready) {
+        handle.destroy();
+    }
+}
+
+void LookupScheduler::spawn(LookupTask task) {
+    ready.push_back(task.handle);
+    task.handle = nullptr;
+    live++;
+}
+
+void LookupScheduler::schedule(std::coroutine_handle<> handle) {
+    ready.push_back(handle);
+}
+
+void LookupScheduler::run() {
+    while (!ready.empty()) {
+        std::coroutine_handle<> handle = ready.front();
+        ready.pop_front();
+
+        try {
+            handle.resume();
+        } catch (...) {
+            // the task is sitting at its final suspend point now
+            handle.destroy();
+            live--;
+            throw;
+        }
+
+        // either it's finished or it queued itself again through get_async
+        if (handle.done()) {
+            handle.destroy();
+            live--;
+        }
+    }
+}
+
+size_t LookupScheduler::pending() const {
+    return live;
+}
+
+bool HashTable::AsyncGet::await_ready() const {
+    return table.filterRejects(raw); // definite miss, no point suspending
+}
+
+void HashTable::AsyncGet::await_suspend(std::coroutine_handle<> handle) {
+    // start pulling the home bucket in, then let the other lookups run while it arrives
+    __builtin_prefetch(&table.buckets[raw % table.currentCapacity]);
+    scheduler.schedule(handle);
+}
+
+std::optional<size_t> HashTable::AsyncGet::await_resume() const {
+    return table.getHashed(key, raw);
+}
+
+HashTable::AsyncGet HashTable::get_async(const std::string& key, LookupScheduler& scheduler) const {
+    return AsyncGet{*this, key, rawHash(key), scheduler};
+}
@@ -0,0 +1,73 @@
+/**
+ * HashTableAsync.h
+ */
+
+#ifndef HASHTABLEASYNC_H
+#define HASHTABLEASYNC_H
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <vector>
+
+// coroutine type for batched lookups: write a function returning LookupTask that
+// co_awaits HashTable::get_async, hand it to a LookupScheduler, call run()
+// tasks start suspended and are owned (and destroyed) by the scheduler they're spawned on
+class LookupTask {
+    public:
+        struct promise_type {
+            LookupTask get_return_object() {
+                return LookupTask(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            // let it escape from resume(), LookupScheduler::run cleans up and rethrows
+            void unhandled_exception() { throw; }
+        };
+
+        LookupTask(LookupTask&& other) noexcept : handle(other.handle) {
+            other.handle = nullptr;
+        }
+        LookupTask(const LookupTask&) = delete;
+        LookupTask& operator=(const LookupTask&) = delete;
+        LookupTask& operator=(LookupTask&&) = delete;
+        ~LookupTask() {
+            if (handle) {
+                handle.destroy(); // never spawned
+            }
+        }
+
+    private:
+        friend class LookupScheduler;
+        explicit LookupTask(std::coroutine_handle<promise_type> h) : handle(h) {}
+        std::coroutine_handle<promise_type> handle;
+};
+
+// single threaded round robin scheduler
+// every get_async prefetches its bucket and goes to the back of the queue, so by the time a
+// lookup resumes the other in-flight lookups have had their turn and its cache line has (hopefully) arrived
+class LookupScheduler {
+    public:
+        LookupScheduler() = default;
+        LookupScheduler(const LookupScheduler&) = delete;
+        LookupScheduler& operator=(const LookupScheduler&) = delete;
+        ~LookupScheduler();
+
+        // take ownership of task, it starts running on the next run()
+        void spawn(LookupTask task);
+        // queue a suspended coroutine to be resumed (get_async does this)
+        void schedule(std::coroutine_handle<> handle);
+        // resume queued coroutines until every task has finished
+        // an exception from a task destroys it and is rethrown here, the rest stay queued
+        void run();
+
+        // tasks spawned but not finished yet
+        size_t pending() const;
+
+    private:
+        std::deque<std::coroutine_handle<>> ready;
+        size_t live = 0;
+};
+
+#endif
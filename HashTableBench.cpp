@@ -0,0 +1,790 @@
+/**
+ * HashTableBench.cpp
+ *
+ * Narrated benchmark harness for the HashTable project.
+ * - Each section builds its own tables, times the operations it is about and prints the numbers
+ * - Sections toggle with #defines like the test harness
+ * - Optional first argument scales the entry count (default 1000000)
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "HashTable.h"
+#include "CuckooHashTable.h"
+#include "FrozenHashTable.h"
+#include "HashTableAsync.h"
+#include "HashTableImpl.h"
+#include "HugePageResource.h"
+#include "IntHashTable.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+#define BENCH_HUGE_PAGES
+#define BENCH_INT_KEYS
+#define BENCH_FREEZE
+#define BENCH_CUCKOO
+#define BENCH_CLOCK_CACHE
+#define BENCH_FILTER
+#define BENCH_ASYNC_GET
+#define BENCH_LOG
+#define BENCH_MEMORY
+#define BENCH_BULK
+#define BENCH_HARDENED
+#define BENCH_VALUE_TYPES
+#define BENCH_PARALLEL_REHASH
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+using bench_clock = chrono::steady_clock;
+
+inline double seconds_since(bench_clock::time_point start) {
+    return chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// keep the optimizer from dropping lookups whose results are never used
+static volatile size_t bench_sink = 0;
+
+vector<string> make_keys(size_t count) {
+    vector<string> keys;
+    keys.reserve(count);
+    for (size_t i = 0; i < count; i++)
+        keys.push_back("key-" + to_string(i));
+    return keys;
+}
+
+// random indexes into keys, fixed seed so every run probes the same sequence
+vector<size_t> make_trace(size_t count, size_t range, uint32_t seed = 12345) {
+    mt19937_64 gen(seed);
+    uniform_int_distribution<size_t> dist(0, range - 1);
+    vector<size_t> trace(count);
+    for (auto& t : trace)
+        t = dist(gen);
+    return trace;
+}
+
+// Zipf distributed indexes into [0, range), item 0 the most popular (skew ~.99 is typical for caches)
+vector<size_t> make_zipf_trace(size_t count, size_t range, double skew, uint32_t seed = 4242) {
+    vector<double> cdf(range);
+    double sum = 0;
+    for (size_t i = 0; i < range; i++) {
+        sum += 1.0 / pow(static_cast<double>(i + 1), skew);
+        cdf[i] = sum;
+    }
+    mt19937_64 gen(seed);
+    uniform_real_distribution<double> dist(0, sum);
+    vector<size_t> trace(count);
+    for (auto& t : trace)
+        t = static_cast<size_t>(lower_bound(cdf.begin(), cdf.end(), dist(gen)) - cdf.begin());
+    // popularity shouldn't line up with insertion order
+    vector<size_t> shuffle(range);
+    for (size_t i = 0; i < range; i++)
+        shuffle[i] = i;
+    std::shuffle(shuffle.begin(), shuffle.end(), gen);
+    for (auto& t : trace)
+        t = shuffle[t];
+    return trace;
+}
+
+void print_memory(const char* label, const HashTable& ht) {
+    HashTableMemory m = ht.memory_usage();
+    double per = 1.0 / static_cast<double>(max<size_t>(ht.size(), 1));
+    cout << "  " << label << " capacity " << ht.capacity() << ", " << m.total * per << " B/entry = buckets "
+         << m.buckets * per << " (padding " << m.bucketPadding * per << ") + side tables " << m.sideTables * per
+         << " + keys " << m.keyHeap * per << " + tombstones " << m.tombstones * per << " + slack " << m.slack * per
+         << " + free in key pool " << m.keyPoolFree * per << endl;
+}
+
+// one of several interleaved lookup streams for the get_async benchmark
+LookupTask lookup_stream(const HashTable& ht, LookupScheduler& sched, const vector<string>& keys,
+                         const vector<size_t>& trace, size_t first, size_t stride, size_t& found) {
+    for (size_t i = first; i < trace.size(); i += stride)
+        found += (co_await ht.get_async(keys[trace[i]], sched)).has_value();
+}
+
+// data TLB read misses for the calling thread via perf_event_open
+// most containers and locked down kernels refuse it, then value() is just empty
+class TlbMissCounter {
+public:
+    TlbMissCounter() {
+#ifdef __linux__
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    ~TlbMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+    void start() {
+#ifdef __linux__
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    optional<uint64_t> stop() {
+#ifdef __linux__
+        if (fd < 0) return nullopt;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count = 0;
+        if (read(fd, &count, sizeof(count)) != sizeof(count)) return nullopt;
+        return count;
+#else
+        return nullopt;
+#endif
+    }
+private:
+    int fd = -1;
+};
+
+// -----------------------------------------------------------------------------
+// Main
+// -----------------------------------------------------------------------------
+int main(int argc, char** argv) {
+    size_t N = 1000000;
+    if (argc > 1)
+        N = stoull(argv[1]);
+
+    cout << "+======================+" << endl;
+    cout << "| HASH TABLE BENCHMARK |" << endl;
+    cout << "+======================+" << endl << endl;
+    cout << "Entries per table: " << N << endl << endl;
+
+    const vector<string> keys = make_keys(N);
+
+    // =====================================================================
+    // HUGE PAGES / NUMA
+    // =====================================================================
+    cout << "Benchmarking random get() with huge page / NUMA backed buckets" << endl;
+    cout << "--------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_HUGE_PAGES
+    {
+        const vector<size_t> trace = make_trace(N * 4, N);
+
+        struct Config { const char* name; optional<HugePageMode> mode; NumaPolicy policy; };
+        const Config configs[] = {
+            {"default heap", nullopt, NumaPolicy::LOCAL},
+            {"4 KB mmap", HugePageMode::NORMAL, NumaPolicy::LOCAL},
+            {"transparent 2 MB", HugePageMode::TRANSPARENT, NumaPolicy::LOCAL},
+            {"explicit 2 MB (MAP_HUGETLB)", HugePageMode::EXPLICIT, NumaPolicy::LOCAL},
+            {"transparent 2 MB, interleaved", HugePageMode::TRANSPARENT, NumaPolicy::INTERLEAVE},
+        };
+
+        for (const auto& config : configs) {
+            optional<HugePageResource> pages;
+            if (config.mode)
+                pages.emplace(*config.mode, config.policy);
+
+            HashTable ht(8, pmr::new_delete_resource(), pages ? &*pages : nullptr);
+            ht.reserve(N);
+            for (size_t i = 0; i < N; i++)
+                ht.insert(keys[i], i);
+
+            TlbMissCounter tlb;
+            auto start = bench_clock::now();
+            tlb.start();
+            size_t found = 0;
+            for (size_t t : trace)
+                found += ht.get(keys[t]).has_value();
+            auto misses = tlb.stop();
+            double secs = seconds_since(start);
+            bench_sink = bench_sink + found;
+
+            cout << "  " << config.name << ":" << endl;
+            cout << "    " << trace.size() << " lookups in " << secs << " s, "
+                 << (secs * 1e9 / static_cast<double>(trace.size())) << " ns/lookup" << endl;
+            cout << "    dTLB read misses: ";
+            if (misses)
+                cout << *misses << " (" << (static_cast<double>(*misses) / static_cast<double>(trace.size())) << " per lookup)";
+            else
+                cout << "n/a (perf_event_open not permitted)";
+            cout << endl;
+            if (pages) {
+                cout << "    mapped " << pages->bytesMapped() / (1 << 20) << " MB, hugetlb fallbacks "
+                     << pages->hugeTlbFallbacks() << ", mbind failures " << pages->numaFailures() << endl;
+            }
+        }
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK HUGE PAGES ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // INTEGER KEYS
+    // =====================================================================
+    cout << "Benchmarking IntHashTable against HashTable with the same ids as string keys" << endl;
+    cout << "----------------------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_INT_KEYS
+    {
+        const vector<size_t> trace = make_trace(N * 4, N);
+
+        auto start = bench_clock::now();
+        HashTable ht;
+        for (size_t i = 0; i < N; i++)
+            ht.insert(keys[i], i);
+        double insertSecs = seconds_since(start);
+        start = bench_clock::now();
+        size_t found = 0;
+        for (size_t t : trace)
+            found += ht.get(keys[t]).has_value();
+        double getSecs = seconds_since(start);
+        bench_sink = bench_sink + found;
+        // bucket + offsets entry, key bytes beyond SSO not counted
+        size_t stringSlot = sizeof(HashTableBucket) + sizeof(size_t);
+        cout << "  HashTable:    insert " << insertSecs * 1e9 / N << " ns/op, get "
+             << getSecs * 1e9 / trace.size() << " ns/op, " << stringSlot << " bytes/slot, "
+             << stringSlot * ht.capacity() / (1 << 20) << " MB" << endl;
+
+        start = bench_clock::now();
+        IntHashTable it;
+        for (size_t i = 0; i < N; i++)
+            it.insert(i, i);
+        insertSecs = seconds_since(start);
+        start = bench_clock::now();
+        found = 0;
+        for (size_t t : trace)
+            found += it.get(t).has_value();
+        getSecs = seconds_since(start);
+        bench_sink = bench_sink + found;
+        cout << "  IntHashTable: insert " << insertSecs * 1e9 / N << " ns/op, get "
+             << getSecs * 1e9 / trace.size() << " ns/op, " << sizeof(IntHashTableSlot) << " bytes/slot, "
+             << sizeof(IntHashTableSlot) * it.capacity() / (1 << 20) << " MB" << endl << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK INT KEYS ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // FREEZE
+    // =====================================================================
+    cout << "Benchmarking freeze() build time and frozen vs live lookups" << endl;
+    cout << "-----------------------------------------------------------" << endl << endl;
+#ifdef BENCH_FREEZE
+    {
+        const vector<size_t> trace = make_trace(N * 4, N);
+        // half of these ids were never inserted
+        const vector<size_t> missTrace = make_trace(N * 4, N * 2, 777);
+        const vector<string> missKeys = make_keys(N * 2);
+
+        HashTable ht;
+        for (size_t i = 0; i < N; i++)
+            ht.insert(keys[i], i);
+
+        auto start = bench_clock::now();
+        FrozenHashTable frozen = ht.freeze();
+        double buildSecs = seconds_since(start);
+        cout << "  freeze() of " << N << " entries: " << buildSecs << " s ("
+             << buildSecs * 1e9 / N << " ns/key), alpha " << ht.alpha() << " -> " << frozen.alpha() << endl;
+
+        auto time_lookups = [&](const auto& table, const vector<size_t>& t, const vector<string>& k) {
+            auto begin = bench_clock::now();
+            size_t found = 0;
+            for (size_t i : t)
+                found += table.get(k[i]).has_value();
+            bench_sink = bench_sink + found;
+            return seconds_since(begin) * 1e9 / static_cast<double>(t.size());
+        };
+        cout << "  hits:        live " << time_lookups(ht, trace, keys) << " ns/op, frozen "
+             << time_lookups(frozen, trace, keys) << " ns/op" << endl;
+        cout << "  50% misses:  live " << time_lookups(ht, missTrace, missKeys) << " ns/op, frozen "
+             << time_lookups(frozen, missTrace, missKeys) << " ns/op" << endl << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK FREEZE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // CUCKOO ENGINE
+    // =====================================================================
+    cout << "Benchmarking CuckooHashTable vs HashTable lookup latency (including the tail)" << endl;
+    cout << "-----------------------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_CUCKOO
+    {
+        const vector<size_t> trace = make_trace(N * 4, N);
+        const vector<size_t> missTrace = make_trace(N, N * 2, 777);
+        const vector<string> missKeys = make_keys(N * 2);
+
+        // each sample is a batch of lookups so clock overhead doesn't swamp a single probe
+        constexpr size_t BATCH = 16;
+        auto report = [&](const char* name, const auto& table, double insertSecs) {
+            vector<double> samples;
+            samples.reserve(trace.size() / BATCH);
+            size_t found = 0;
+            auto total = bench_clock::now();
+            for (size_t i = 0; i + BATCH <= trace.size(); i += BATCH) {
+                auto begin = bench_clock::now();
+                for (size_t j = i; j < i + BATCH; j++)
+                    found += table.get(keys[trace[j]]).has_value();
+                samples.push_back(chrono::duration<double, nano>(bench_clock::now() - begin).count() / BATCH);
+            }
+            double totalSecs = seconds_since(total);
+            auto missStart = bench_clock::now();
+            for (size_t t : missTrace)
+                found += table.contains(missKeys[t]);
+            double missNs = seconds_since(missStart) * 1e9 / static_cast<double>(missTrace.size());
+            bench_sink = bench_sink + found;
+
+            sort(samples.begin(), samples.end());
+            auto pct = [&](double p) { return samples[static_cast<size_t>(p * static_cast<double>(samples.size() - 1))]; };
+            cout << "  " << name << ": insert " << insertSecs * 1e9 / N << " ns/op, get "
+                 << totalSecs * 1e9 / static_cast<double>(trace.size()) << " ns/op (p50 " << pct(.5)
+                 << ", p99 " << pct(.99) << ", p99.99 " << pct(.9999) << "), 50% miss contains "
+                 << missNs << " ns/op, alpha " << table.alpha() << endl;
+        };
+
+        auto start = bench_clock::now();
+        HashTable ht;
+        for (size_t i = 0; i < N; i++)
+            ht.insert(keys[i], i);
+        report("HashTable      ", ht, seconds_since(start));
+
+        start = bench_clock::now();
+        CuckooHashTable ct;
+        for (size_t i = 0; i < N; i++)
+            ct.insert(keys[i], i);
+        report("CuckooHashTable", ct, seconds_since(start));
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK CUCKOO ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // BOUNDED CACHE (CLOCK)
+    // =====================================================================
+    cout << "Benchmarking setMaxSize() cache mode on Zipfian traces" << endl;
+    cout << "------------------------------------------------------" << endl << endl;
+#ifdef BENCH_CLOCK_CACHE
+    {
+        for (double skew : {0.8, 0.99, 1.2}) {
+            const vector<size_t> trace = make_zipf_trace(N * 2, N, skew);
+            for (double fraction : {0.01, 0.1}) {
+                size_t limit = max<size_t>(1, static_cast<size_t>(static_cast<double>(N) * fraction));
+                HashTable cache;
+                cache.setMaxSize(limit);
+
+                // read-through cache: miss -> insert
+                size_t hits = 0;
+                auto start = bench_clock::now();
+                for (size_t t : trace) {
+                    if (cache.get(keys[t]).has_value())
+                        hits++;
+                    else
+                        cache.insert(keys[t], t);
+                }
+                double secs = seconds_since(start);
+                cout << "  skew " << skew << ", cache " << fraction * 100 << "% of keys (" << limit << "): hit ratio "
+                     << static_cast<double>(hits) / static_cast<double>(trace.size()) << ", "
+                     << static_cast<double>(trace.size()) / secs / 1e6 << " M ops/s, evictions "
+                     << cache.stats().evictions << ", capacity " << cache.capacity() << endl;
+            }
+        }
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK CLOCK CACHE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // BLOOM PREFILTER
+    // =====================================================================
+    cout << "Benchmarking contains() misses with and without the Bloom prefilter" << endl;
+    cout << "-------------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_FILTER
+    {
+        const vector<string> missKeys = make_keys(N * 2);
+        const vector<size_t> missTrace = make_trace(N * 2, N, 99);
+
+        for (bool filtered : {false, true}) {
+            HashTable ht;
+            ht.setFilter(filtered);
+            for (size_t i = 0; i < N; i++)
+                ht.insert(keys[i], i);
+            // leave tombstones behind so misses have longer walks
+            for (size_t i = 0; i < N; i += 4)
+                ht.remove(keys[i]);
+
+            size_t found = 0;
+            auto start = bench_clock::now();
+            for (size_t t : missTrace)
+                found += ht.contains(missKeys[N + t]); // never inserted
+            double missNs = seconds_since(start) * 1e9 / static_cast<double>(missTrace.size());
+            start = bench_clock::now();
+            for (size_t t : missTrace)
+                found += ht.contains(keys[t]); // 75% hits
+            double mixedNs = seconds_since(start) * 1e9 / static_cast<double>(missTrace.size());
+            bench_sink = bench_sink + found;
+            cout << "  " << (filtered ? "with filter:   " : "without filter:") << " all-miss contains "
+                 << missNs << " ns/op, 75% hit contains " << mixedNs << " ns/op" << endl;
+        }
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK FILTER ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // ASYNC GET
+    // =====================================================================
+    cout << "Benchmarking interleaved get_async() against sequential get()" << endl;
+    cout << "-------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_ASYNC_GET
+    {
+        const vector<size_t> trace = make_trace(N * 4, N);
+        HashTable ht;
+        for (size_t i = 0; i < N; i++)
+            ht.insert(keys[i], i);
+
+        size_t found = 0;
+        auto start = bench_clock::now();
+        for (size_t t : trace)
+            found += ht.get(keys[t]).has_value();
+        double seqNs = seconds_since(start) * 1e9 / static_cast<double>(trace.size());
+        cout << "  sequential get():            " << seqNs << " ns/op" << endl;
+
+        for (size_t inFlight : {1, 4, 8, 16, 32}) {
+            LookupScheduler sched;
+            for (size_t s = 0; s < inFlight; s++)
+                sched.spawn(lookup_stream(ht, sched, keys, trace, s, inFlight, found));
+            start = bench_clock::now();
+            sched.run();
+            double ns = seconds_since(start) * 1e9 / static_cast<double>(trace.size());
+            cout << "  get_async(), " << inFlight << (inFlight < 10 ? " " : "") << " in flight:    " << ns
+                 << " ns/op (" << seqNs / ns << "x)" << endl;
+        }
+        bench_sink = bench_sink + found;
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK ASYNC GET ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // CHANGE LOG
+    // =====================================================================
+    cout << "Benchmarking write throughput with the change log on" << endl;
+    cout << "----------------------------------------------------" << endl << endl;
+#ifdef BENCH_LOG
+    {
+        const std::filesystem::path dir = std::filesystem::temp_directory_path() / "hashtable_log_bench";
+        const vector<size_t> trace = make_trace(N, N);
+        double baseNs = 0;
+
+        for (bool logged : {false, true}) {
+            std::filesystem::remove_all(dir);
+            {
+                HashTable ht;
+                if (logged)
+                    ht.enableLog(dir.string());
+
+                // inserts, then operator[] updates over a random trace
+                auto start = bench_clock::now();
+                for (size_t i = 0; i < N; i++)
+                    ht.insert(keys[i], i);
+                for (size_t t : trace)
+                    ht[keys[t]] += 1;
+                ht.syncLog(); // counts getting it all on disk
+                double ns = seconds_since(start) * 1e9 / static_cast<double>(N + trace.size());
+
+                if (!logged) {
+                    baseNs = ns;
+                    cout << "  no log:              " << ns << " ns/write" << endl;
+                    continue;
+                }
+                cout << "  with log:            " << ns << " ns/write (" << (ns / baseNs - 1) * 100 << "% overhead)" << endl;
+
+                start = bench_clock::now();
+                ht.snapshot();
+                ht.syncLog();
+                cout << "  full snapshot:       " << seconds_since(start) * 1e3 << " ms for " << ht.size() << " entries" << endl;
+            }
+
+            auto start = bench_clock::now();
+            HashTable back = HashTable::recover(dir.string());
+            cout << "  recover:             " << seconds_since(start) * 1e3 << " ms for " << back.size() << " entries" << endl;
+        }
+        std::filesystem::remove_all(dir);
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK LOG ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // MEMORY USAGE
+    // =====================================================================
+    cout << "Memory per entry (memory_usage) before and after shrink_to_fit" << endl;
+    cout << "--------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_MEMORY
+    {
+        for (bool longKeys : {false, true}) {
+            HashTable ht;
+            for (size_t i = 0; i < N; i++)
+                ht.insert(longKeys ? keys[i] + "-with-a-suffix-past-the-inline-buffer" : keys[i], i);
+            cout << (longKeys ? "Heap keys (~45 bytes):" : "Inline keys (<16 bytes):") << endl;
+            print_memory("full:       ", ht);
+            for (size_t i = 0; i < N; i++)
+                if (i % 4 != 0)
+                    ht.remove(longKeys ? keys[i] + "-with-a-suffix-past-the-inline-buffer" : keys[i]);
+            print_memory("75% removed:", ht);
+            auto start = bench_clock::now();
+            ht.shrink_to_fit();
+            double ms = seconds_since(start) * 1e3;
+            print_memory("shrunk:     ", ht);
+            cout << "  shrink_to_fit took " << ms << " ms" << endl;
+        }
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK MEMORY ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // BULK OPERATIONS
+    // =====================================================================
+    cout << "Benchmarking for_each / erase_if / merge against thread count" << endl;
+    cout << "-------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_BULK
+    {
+        vector<size_t> threadCounts = {1, 2, 4};
+        if (thread::hardware_concurrency() > 4)
+            threadCounts.push_back(thread::hardware_concurrency());
+        cout << "  (" << thread::hardware_concurrency() << " hardware threads)" << endl;
+
+        HashTable delta;
+        for (size_t i = N / 2; i < N + N / 2 && i < keys.size(); i++)
+            delta.insert(keys[i], i);
+        for (size_t i = N; i < N + N / 2; i++)
+            delta.insert("delta-" + to_string(i), i);
+
+        for (size_t threads : threadCounts) {
+            ThreadPool pool(threads);
+            HashTable ht;
+            for (size_t i = 0; i < N; i++)
+                ht.insert(keys[i], i);
+            ht.setThreadPool(&pool);
+
+            auto start = bench_clock::now();
+            ht.for_each([](std::string_view, size_t& v) { v = v * 3 + 1; });
+            double forEachMs = seconds_since(start) * 1e3;
+
+            start = bench_clock::now();
+            size_t added = ht.merge(delta);
+            double mergeMs = seconds_since(start) * 1e3;
+
+            start = bench_clock::now();
+            size_t erased = ht.erase_if([](std::string_view, size_t v) { return v % 4 == 0; });
+            double eraseMs = seconds_since(start) * 1e3;
+
+            bench_sink = bench_sink + added + erased;
+            cout << "  " << threads << " thread" << (threads == 1 ? ": " : "s:") << " for_each " << forEachMs
+                 << " ms, merge " << mergeMs << " ms (" << added << " new), erase_if " << eraseMs
+                 << " ms (" << erased << " erased)" << endl;
+        }
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK BULK ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // HARDENED MODE
+    // =====================================================================
+    cout << "Benchmarking std::hash against keyed SipHash, normal keys and a collision flood" << endl;
+    cout << "-------------------------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_HARDENED
+    {
+        const vector<size_t> trace = make_trace(N, N);
+        for (bool hardened : {false, true}) {
+            HashTable ht;
+            ht.setHardened(hardened);
+            auto start = bench_clock::now();
+            for (size_t i = 0; i < N; i++)
+                ht.insert(keys[i], i);
+            double insertNs = seconds_since(start) * 1e9 / static_cast<double>(N);
+            size_t found = 0;
+            start = bench_clock::now();
+            for (size_t t : trace)
+                found += ht.contains(keys[t]);
+            double lookupNs = seconds_since(start) * 1e9 / static_cast<double>(trace.size());
+            bench_sink = bench_sink + found;
+            cout << "  " << (hardened ? "SipHash:  " : "std::hash:") << " insert " << insertNs << " ns/op, contains "
+                 << lookupNs << " ns/op" << endl;
+        }
+
+        // what an attacker who knows the table uses std::hash would send: every key on one home bucket
+        constexpr size_t FLOOD = 2000;
+        vector<string> flood;
+        size_t target = hash<string>()("f0") % 16384;
+        for (size_t i = 0; flood.size() < FLOOD; i++) {
+            string k = "f" + to_string(i);
+            if (hash<string>()(k) % 16384 == target)
+                flood.push_back(k);
+        }
+        for (bool hardened : {false, true}) {
+            HashTable ht;
+            ht.setHardened(hardened);
+            auto start = bench_clock::now();
+            for (const auto& k : flood)
+                ht.insert(k, 1);
+            double insertNs = seconds_since(start) * 1e9 / static_cast<double>(FLOOD);
+            size_t found = 0;
+            start = bench_clock::now();
+            for (size_t rep = 0; rep < 50; rep++)
+                for (const auto& k : flood)
+                    found += ht.contains(k);
+            double lookupNs = seconds_since(start) * 1e9 / static_cast<double>(FLOOD * 50);
+            bench_sink = bench_sink + found;
+            cout << "  flood of " << FLOOD << (hardened ? ", hardened from the start:" : ", plain table:           ")
+                 << " insert " << insertNs << " ns/op, contains " << lookupNs << " ns/op, reseeds "
+                 << ht.stats().reseeds << endl;
+        }
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK HARDENED ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // VALUE TYPES
+    // =====================================================================
+    cout << "Benchmarking HashTable_t with 256 byte values in place and out of line, get() against find()" << endl;
+    cout << "--------------------------------------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_VALUE_TYPES
+    {
+        // big values, fewer of them so the in place table still fits comfortably
+        const size_t count = max<size_t>(N / 8, 1);
+        const vector<size_t> trace = make_trace(count * 4, count);
+        using Blob = array<uint64_t, 32>;
+
+        auto run = [&](auto& ht, const char* label) {
+            auto start = bench_clock::now();
+            for (size_t i = 0; i < count; i++) {
+                Blob b{};
+                b[0] = i;
+                ht.insert(keys[i], b);
+            }
+            double insertNs = seconds_since(start) * 1e9 / static_cast<double>(count);
+            size_t sum = 0;
+            start = bench_clock::now();
+            for (size_t t : trace)
+                sum += (*ht.get(keys[t]))[0];
+            double getNs = seconds_since(start) * 1e9 / static_cast<double>(trace.size());
+            start = bench_clock::now();
+            for (size_t t : trace)
+                sum += (*ht.find(keys[t]))[0];
+            double findNs = seconds_since(start) * 1e9 / static_cast<double>(trace.size());
+            bench_sink = bench_sink + sum;
+            cout << "  " << label << " insert " << insertNs << " ns/op, get (copy) " << getNs << " ns/op, find "
+                 << findNs << " ns/op" << endl;
+        };
+        {
+            HashTable_t<string, Blob, hash<string>, sizeof(Blob)> inPlace;
+            run(inPlace, "in place:   ");
+        }
+        {
+            HashTable_t<string, Blob> outOfLine;
+            run(outOfLine, "out of line:");
+        }
+
+        // size_t values, the generic table against HashTable itself
+        HashTable plain;
+        HashTable_t<string, size_t> generic;
+        for (size_t i = 0; i < count; i++) {
+            plain.insert(keys[i], i);
+            generic.insert(keys[i], i);
+        }
+        size_t sum = 0;
+        auto start = bench_clock::now();
+        for (size_t t : trace)
+            sum += *plain.find(keys[t]);
+        double plainNs = seconds_since(start) * 1e9 / static_cast<double>(trace.size());
+        start = bench_clock::now();
+        for (size_t t : trace)
+            sum += *generic.find(keys[t]);
+        double genericNs = seconds_since(start) * 1e9 / static_cast<double>(trace.size());
+        bench_sink = bench_sink + sum;
+        cout << "  size_t values: HashTable::find " << plainNs << " ns/op, HashTable_t::find " << genericNs
+             << " ns/op" << endl;
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK VALUE TYPES ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // PARALLEL REHASH
+    // =====================================================================
+    cout << "Benchmarking rehash() (buckets, offsets and placement) across thread pool sizes" << endl;
+    cout << "-------------------------------------------------------------------------------" << endl << endl;
+#ifdef BENCH_PARALLEL_REHASH
+    {
+        vector<size_t> threadCounts = {1, 2, 4};
+        if (thread::hardware_concurrency() > 4)
+            threadCounts.push_back(thread::hardware_concurrency());
+        cout << "  (" << thread::hardware_concurrency() << " hardware threads)" << endl;
+
+        HashTable ht;
+        for (size_t i = 0; i < N; i++)
+            ht.insert(keys[i], i);
+
+        double serialMs = 0;
+        for (size_t threads : threadCounts) {
+            ThreadPool pool(threads);
+            ht.setThreadPool(&pool);
+            // same capacity rebuild, then one doubling, so every run does the same work
+            auto start = bench_clock::now();
+            ht.rehash(ht.capacity());
+            double sameMs = seconds_since(start) * 1e3;
+            size_t before = ht.capacity();
+            start = bench_clock::now();
+            ht.rehash(before * 2);
+            double growMs = seconds_since(start) * 1e3;
+            ht.setThreadPool(nullptr);
+            ht.rehash(before); // back down for the next run
+
+            if (threads == 1)
+                serialMs = sameMs;
+            cout << "  " << threads << " thread" << (threads == 1 ? ": " : "s:") << " rehash at " << before << " buckets "
+                 << sameMs << " ms (" << serialMs / sameMs << "x), to " << before * 2 << " buckets " << growMs << " ms" << endl;
+        }
+        cout << endl;
+    }
+#else
+    cout << "*** DID NOT BENCHMARK PARALLEL REHASH ***" << endl << endl;
+#endif
+
+    cout << "All benchmarks complete." << endl;
+    return 0;
+}
@@ -0,0 +1,354 @@
+/**
+ * HashTableFuzz.cpp
+ *
+ * Differential fuzzing: turns a byte string into a long sequence of operations, runs it
+ * against HashTable and a std::unordered_map side by side and stops at the first answer
+ * that differs.
+ *
+ * - sequences alternate between plain and key arena tables, with and without a thread pool
+ * - default build: randomized driver, HashTableFuzz [sequences] [seed] (no seed = random one)
+ * - -DHT_LIBFUZZER (clang + -fsanitize=fuzzer, see HT_LIBFUZZER in CMakeLists.txt):
+ *   libFuzzer entry point over the same byte format
+ * - HT_SANITIZE=address,undefined or thread in CMake builds everything under sanitizers
+ */
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory_resource>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "HashTable.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+namespace {
+
+// reads the input one byte at a time, zeros once it runs out
+class ByteStream {
+    public:
+        ByteStream(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+        bool empty() const { return pos >= size; }
+
+        uint8_t next() { return pos < size ? data[pos++] : 0; }
+
+        size_t nextValue() {
+            size_t v = next();
+            return (v << 8) | next();
+        }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t pos = 0;
+};
+
+// keys that all land in the same bucket for every power of two capacity up to 4096
+const vector<string>& colliding_keys() {
+    static const vector<string> keys = [] {
+        vector<string> found;
+        size_t target = hash<string>()("c0") % 4096;
+        for (size_t i = 0; found.size() < 32; i++) {
+            string k = "c" + to_string(i);
+            if (hash<string>()(k) % 4096 == target)
+                found.push_back(k);
+        }
+        return found;
+    }();
+    return keys;
+}
+
+// small key space so inserts, removes and lookups keep running into each other
+string pick_key(uint8_t b) {
+    switch (b >> 6) {
+        case 0:
+        case 1:
+            return "k" + to_string(b % 48);
+        case 2:
+            return "a-key-long-enough-for-the-heap-" + to_string(b % 48);
+        default:
+            return colliding_keys()[b % colliding_keys().size()];
+    }
+}
+
+struct Mismatch : runtime_error {
+    using runtime_error::runtime_error;
+};
+
+void expect(bool ok, size_t step, const string& what) {
+    if (!ok) {
+        ostringstream msg;
+        msg << "operation " << step << ": " << what;
+        throw Mismatch(msg.str());
+    }
+}
+
+// everything the model knows, checked against the table
+void full_check(const HashTable& ht, const unordered_map<string, size_t>& model, size_t step) {
+    for (const auto& [k, v] : model) {
+        auto res = ht.get(k);
+        expect(res && *res == v, step, "get(" + k + ") lost or wrong");
+    }
+    vector<string> keys = ht.keys();
+    expect(keys.size() == model.size(), step, "keys() has " + to_string(keys.size()) + " keys, model " + to_string(model.size()));
+    for (const auto& k : keys)
+        expect(model.count(k) == 1, step, "keys() has " + k + " which was never inserted or was removed");
+}
+
+// cache mode evicts entries the model can't predict: drop whatever the table no longer has,
+// as long as there were at least that many evictions since the last look
+void reconcile(const HashTable& ht, unordered_map<string, size_t>& model, size_t& evictionsSeen, size_t step) {
+    size_t evictions = ht.stats().evictions;
+    size_t missing = erase_if(model, [&ht](const auto& kv) { return !ht.contains(kv.first); });
+    expect(missing <= evictions - evictionsSeen, step, to_string(missing) + " keys gone after " +
+           to_string(evictions - evictionsSeen) + " evictions");
+    evictionsSeen = evictions;
+    if (ht.maxSize() != 0)
+        expect(ht.size() <= ht.maxSize(), step, "size() " + to_string(ht.size()) + " over the limit");
+}
+
+// one sequence, throws Mismatch at the first difference
+void run_sequence(const uint8_t* data, size_t size, ThreadPool* pool, bool arena) {
+    ByteStream in(data, size);
+    HashTable ht = arena ? HashTable(8, std::pmr::new_delete_resource()) : HashTable();
+    ht.setThreadPool(pool);
+    unordered_map<string, size_t> model;
+    // entries that expired but might still be counted by size() until something reclaims them
+    bool zombies = false;
+    size_t evictionsSeen = 0;
+
+    for (size_t step = 0; !in.empty(); step++) {
+        uint8_t op = in.next() % 25;
+        uint8_t arg = in.next();
+        string key = pick_key(arg);
+
+        switch (op) {
+            case 0: case 1: case 2: case 3: {
+                size_t v = in.nextValue();
+                bool fresh = model.count(key) == 0;
+                expect(ht.insert(key, v) == fresh, step, "insert(" + key + ") return value");
+                if (fresh)
+                    model[key] = v;
+                break;
+            }
+            case 4: {
+                // TTLs either never run out during a run or are already over, so the model stays exact
+                size_t v = in.nextValue();
+                bool longLived = in.next() & 1;
+                bool fresh = model.count(key) == 0;
+                bool r = longLived ? ht.insert(key, v, chrono::hours(1)) : ht.insert(key, v, chrono::nanoseconds(0));
+                expect(r == fresh, step, "insert(" + key + ", ttl) return value");
+                if (fresh && longLived)
+                    model[key] = v;
+                zombies |= (fresh && !longLived);
+                break;
+            }
+            case 5: {
+                bool longLived = in.next() & 1;
+                bool present = model.count(key) == 1;
+                bool r = longLived ? ht.expire(key, chrono::hours(1)) : ht.expire(key, chrono::nanoseconds(0));
+                expect(r == present, step, "expire(" + key + ") return value");
+                if (present && !longLived) {
+                    model.erase(key);
+                    zombies = true;
+                }
+                break;
+            }
+            case 6: case 7:
+                expect(ht.remove(key) == (model.erase(key) == 1), step, "remove(" + key + ") return value");
+                break;
+            case 8: case 9: {
+                auto res = ht.get(key);
+                auto it = model.find(key);
+                expect(res.has_value() == (it != model.end()) && (!res || *res == it->second), step, "get(" + key + ")");
+                break;
+            }
+            case 10:
+                expect(ht.contains(key) == (model.count(key) == 1), step, "contains(" + key + ")");
+                break;
+            case 11: {
+                size_t delta = in.next();
+                auto it = model.find(key);
+                bool threw = false;
+                try {
+                    size_t& ref = ht[key];
+                    expect(it != model.end() && ref == it->second, step, "operator[](" + key + ") read");
+                    ref += delta;
+                } catch (const Mismatch&) {
+                    throw;
+                } catch (const runtime_error&) {
+                    threw = true;
+                }
+                expect(threw == (it == model.end()), step, "operator[](" + key + ") on a missing key");
+                if (it != model.end())
+                    it->second += delta;
+                break;
+            }
+            case 12:
+                ht.rehash(arg * 4);
+                zombies = false; // rehash drops expired entries
+                break;
+            case 13:
+                // now and then big enough that the next rehash goes through the pool
+                ht.reserve(arg == 255 ? 40000 : arg);
+                break;
+            case 14:
+                if (arg < 16) {
+                    ht.clear();
+                    model.clear();
+                    zombies = false;
+                }
+                break;
+            case 15:
+                ht.shrink_to_fit();
+                zombies = false;
+                expect(ht.alpha() < .5, step, "shrink_to_fit left alpha at " + to_string(ht.alpha()));
+                break;
+            case 16: {
+                size_t mod = arg % 7 + 2;
+                size_t rem = in.next() % mod;
+                size_t erased = ht.erase_if([mod, rem](string_view, size_t v) { return v % mod == rem; });
+                size_t expected = erase_if(model, [mod, rem](const auto& kv) { return kv.second % mod == rem; });
+                expect(erased == expected, step, "erase_if count");
+                break;
+            }
+            case 17: {
+                size_t add = arg;
+                ht.for_each([add](string_view k, size_t& v) { if (k.size() % 2 == 0) v += add; });
+                for (auto& [k, v] : model)
+                    if (k.size() % 2 == 0)
+                        v += add;
+                break;
+            }
+            case 18: {
+                HashTable delta;
+                size_t added = 0;
+                for (size_t i = arg % 8; i > 0; i--) {
+                    string k = pick_key(in.next());
+                    size_t v = in.nextValue();
+                    if (delta.insert(k, v)) {
+                        added += model.count(k) == 0;
+                        model[k] = v;
+                    }
+                }
+                expect(ht.merge(delta) == added, step, "merge count");
+                break;
+            }
+            case 19:
+                ht.setFilter(arg & 1);
+                break;
+            case 20:
+                full_check(ht, model, step);
+                break;
+            case 21: {
+                // burst of fresh keys across a resize, then remove most of them again for tombstones
+                size_t count = arg % 64;
+                for (size_t i = 0; i < count; i++) {
+                    string k = "burst" + to_string(step) + "-" + to_string(i);
+                    expect(ht.insert(k, i), step, "burst insert(" + k + ")");
+                    model[k] = i;
+                }
+                for (size_t i = 0; i < count; i++) {
+                    if (i % 4 != 0) {
+                        string k = "burst" + to_string(step) + "-" + to_string(i);
+                        // in cache mode the burst itself can push its first keys out
+                        expect(ht.remove(k) || ht.maxSize() != 0, step, "burst remove(" + k + ")");
+                        model.erase(k);
+                    }
+                }
+                break;
+            }
+            case 22:
+                if (ht.isHardened() != static_cast<bool>(arg & 1)) {
+                    ht.setHardened(arg & 1);
+                    zombies = false; // switching hashes rehashes
+                }
+                break;
+            case 23:
+                // cache mode a bit over half the time it's picked, limits from a few dozen to a couple hundred
+                ht.setMaxSize(arg < 96 ? 0 : arg - 64);
+                break;
+            case 24: {
+                // carry on with a copy (its own arena, if there is one) so the original's memory is gone
+                HashTable copy(8);
+                if (arg & 1)
+                    copy = ht;
+                else
+                    copy = HashTable(ht);
+                full_check(copy, model, step);
+                ht = std::move(copy);
+                break;
+            }
+        }
+
+        if (ht.maxSize() != 0 || ht.stats().evictions != evictionsSeen)
+            reconcile(ht, model, evictionsSeen, step);
+
+        if (zombies && ht.stats().expiring == 0)
+            zombies = false; // the sweeper got them all
+        if (zombies)
+            expect(ht.size() >= model.size(), step, "size() below the model");
+        else
+            expect(ht.size() == model.size(), step, "size() " + to_string(ht.size()) + ", model " + to_string(model.size()));
+        expect(ht.alpha() <= .5 + 1.0 / static_cast<double>(ht.capacity()), step, "alpha " + to_string(ht.alpha()));
+    }
+    full_check(ht, model, SIZE_MAX);
+}
+
+}
+
+#ifdef HT_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    static ThreadPool pool(4);
+    try {
+        run_sequence(data, size, (size > 0 && data[0] & 1) ? &pool : nullptr, size > 0 && data[0] & 2);
+    } catch (const Mismatch& e) {
+        cerr << "MISMATCH: " << e.what() << endl;
+        abort(); // libFuzzer keeps the input
+    }
+    return 0;
+}
+
+#else
+
+int main(int argc, char* argv[]) {
+    size_t sequences = 2000;
+    uint64_t seed = random_device()();
+    if (argc > 1)
+        sequences = stoull(argv[1]);
+    if (argc > 2)
+        seed = stoull(argv[2]);
+
+    ThreadPool pool(4);
+    mt19937_64 gen(seed);
+    uniform_int_distribution<size_t> length(16, 4096);
+    size_t bytes = 0;
+
+    cout << "Fuzzing " << sequences << " sequences, seed " << seed << endl;
+    for (size_t s = 0; s < sequences; s++) {
+        vector<uint8_t> input(length(gen));
+        for (auto& b : input)
+            b = static_cast<uint8_t>(gen());
+        bytes += input.size();
+
+        try {
+            run_sequence(input.data(), input.size(), (s % 2 == 1) ? &pool : nullptr, s % 4 >= 2);
+        } catch (const Mismatch& e) {
+            cout << "MISMATCH in sequence " << s << " (seed " << seed << "): " << e.what() << endl;
+            return 1;
+        }
+    }
+    cout << "All " << sequences << " sequences (~" << bytes / 3 << " operations) matched std::unordered_map." << endl;
+    return 0;
+}
+
+#endif
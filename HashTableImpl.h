@@ -0,0 +1,275 @@
+/**
+ * HashTableImpl.h
+ */
+
+#ifndef HASHTABLEIMPL_H
+#define HASHTABLEIMPL_H
+
+#include "BucketType.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// values up to this many bytes are stored in the bucket by default
+inline constexpr size_t INLINE_VALUE_BYTES = 64;
+
+// HashTable with the key and value types as template parameters, header only
+// same probing as HashTable (shuffled offsets, NORMAL/ESS/EAR, doubles at alpha .5) but none of the
+// extras - no TTL, eviction, filter, log or thread pool
+// - values up to InlineBytes sit in the bucket right after the key, a hit is one trip to memory
+// - bigger values get their own heap node behind a unique_ptr so buckets stay small and probing
+//   stays compact; their address also survives rehashes
+// - find() and operator[] hand out the stored value, get() copies it like HashTable::get does
+template <typename Key, typename Value, typename Hash = std::hash<Key>, size_t InlineBytes = INLINE_VALUE_BYTES>
+class HashTable_t {
+    public:
+        // true when values live out of line
+        static constexpr bool OUT_OF_LINE = sizeof(Value) > InlineBytes;
+
+        // constructor that sets size; default 8
+        explicit HashTable_t(size_t initCapacity = 8) : currentCapacity(initCapacity) {
+            buckets.resize(currentCapacity);
+            shuffleOffsets();
+        }
+
+        bool insert(const Key& key, const Value& value) {
+            return emplace(key, value);
+        }
+
+        bool insert(const Key& key, Value&& value) {
+            return emplace(key, std::move(value));
+        }
+
+        // builds the value in its bucket (or node) from args, false and nothing built for a dupe
+        template <typename... Args>
+        bool emplace(const Key& key, Args&&... args) {
+            // check load factor and resize if needed
+            if (alpha() >= .5) {
+                rehash(currentCapacity * 2);
+            } else if (tombstones * 4 >= currentCapacity) {
+                rehash(currentCapacity); // a quarter of the table is EAR, clear them out
+            }
+
+            size_t home = hash(key);
+            std::optional<size_t> bucket;
+            for (size_t i = 0; i <= offsets.size(); ++i) {
+                size_t index = (i == 0) ? home : (home + offsets[i - 1]) % currentCapacity;
+                const Bucket& probe = buckets[index];
+
+                if (probe.type == BucketType::ESS) {
+                    if (!bucket.has_value()) {
+                        bucket = index;
+                    }
+                    break; // nothing has been past here
+                }
+                if (probe.type == BucketType::EAR) {
+                    if (!bucket.has_value()) {
+                        bucket = index; // keep looking for a dupe further along
+                    }
+                } else if (probe.key == key) {
+                    return false; // dupe
+                }
+            }
+
+            if (!bucket.has_value()) {
+                return false; // should not be needed
+            }
+            Bucket& target = buckets[bucket.value()];
+            if (target.type == BucketType::EAR) {
+                tombstones--;
+            }
+            if constexpr (OUT_OF_LINE) {
+                target.value = std::make_unique<Value>(std::forward<Args>(args)...);
+            } else {
+                target.value.emplace(std::forward<Args>(args)...);
+            }
+            target.key = key;
+            target.type = BucketType::NORMAL;
+            trueSize++;
+            return true;
+        }
+
+        size_t size() const {
+            return trueSize;
+        }
+
+        double alpha() const {
+            return static_cast<double>(trueSize) / static_cast<double>(currentCapacity);
+        }
+
+        size_t capacity() const {
+            return currentCapacity;
+        }
+
+        bool contains(const Key& key) const {
+            return find(key) != nullptr;
+        }
+
+        // copy of the value, same as HashTable::get - use find() for values that are expensive to copy
+        std::optional<Value> get(const Key& key) const {
+            const Value* value = find(key);
+            if (value == nullptr) {
+                return std::nullopt;
+            }
+            return *value;
+        }
+
+        // the stored value, nullptr if key isn't there
+        // good until the next insert, remove or rehash, or until the key is removed for OUT_OF_LINE values
+        Value* find(const Key& key) {
+            size_t index = locate(key);
+            return index == NOT_FOUND ? nullptr : &*buckets[index].value;
+        }
+
+        const Value* find(const Key& key) const {
+            size_t index = locate(key);
+            return index == NOT_FOUND ? nullptr : &*buckets[index].value;
+        }
+
+        Value& operator[](const Key& key) {
+            Value* value = find(key);
+            if (value == nullptr) {
+                throw std::runtime_error("Key not found");
+            }
+            return *value;
+        }
+
+        bool remove(const Key& key) {
+            size_t index = locate(key);
+            if (index == NOT_FOUND) {
+                return false;
+            }
+            buckets[index].value.reset(); // value goes now, the key stays until the bucket is reused
+            buckets[index].type = BucketType::EAR;
+            trueSize--;
+            tombstones++;
+            return true;
+        }
+
+        std::vector<Key> keys() const {
+            std::vector<Key> result;
+            result.reserve(trueSize);
+            for (const auto& bucket : buckets) {
+                if (bucket.type == BucketType::NORMAL) {
+                    result.push_back(bucket.key);
+                }
+            }
+            return result;
+        }
+
+        // move every entry into newCapacity fresh buckets (at least enough to keep alpha < .5), drops EAR buckets
+        // values are moved, OUT_OF_LINE ones just change owner
+        void rehash(size_t newCapacity) {
+            newCapacity = std::max<size_t>(newCapacity, 2);
+            while (static_cast<double>(trueSize) / static_cast<double>(newCapacity) >= .5) {
+                newCapacity *= 2;
+            }
+            std::vector<Bucket> old(newCapacity);
+            old.swap(buckets);
+            currentCapacity = newCapacity;
+            tombstones = 0;
+            shuffleOffsets();
+
+            for (auto& entry : old) {
+                if (entry.type != BucketType::NORMAL) {
+                    continue;
+                }
+                // keys are all distinct, so the first free bucket is the spot
+                size_t home = hash(entry.key);
+                size_t index = home;
+                for (size_t i = 0; buckets[index].type != BucketType::ESS; ++i) {
+                    index = (home + offsets[i]) % currentCapacity;
+                }
+                buckets[index].key = std::move(entry.key);
+                buckets[index].value = std::move(entry.value);
+                buckets[index].type = BucketType::NORMAL;
+            }
+        }
+
+        // same doubling as rehash so capacities stay the same as if we'd grown one insert at a time
+        void reserve(size_t count) {
+            size_t newCapacity = currentCapacity;
+            while (static_cast<double>(count) / static_cast<double>(newCapacity) >= .5) {
+                newCapacity *= 2;
+            }
+            if (newCapacity != currentCapacity) {
+                rehash(newCapacity);
+            }
+        }
+
+        // remove everything, keeps the capacity
+        void clear() {
+            for (auto& bucket : buckets) {
+                bucket = Bucket();
+            }
+            trueSize = 0;
+            tombstones = 0;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const HashTable_t& t) {
+            for (size_t i = 0; i < t.currentCapacity; ++i) {
+                const Bucket& bucket = t.buckets[i];
+                if (bucket.type == BucketType::NORMAL) {
+                    os << "Bucket " << i << ": <" << bucket.key << ", " << *bucket.value << ">" << std::endl;
+                }
+            }
+            return os;
+        }
+
+    private:
+        // optional for inline values so a non default constructible Value is fine and EAR buckets hold none
+        using Slot = std::conditional_t<OUT_OF_LINE, std::unique_ptr<Value>, std::optional<Value>>;
+
+        struct Bucket {
+            Key key{};
+            Slot value;
+            BucketType type = BucketType::ESS;
+        };
+
+        std::vector<Bucket> buckets;
+        std::vector<size_t> offsets;
+        size_t currentCapacity;
+        size_t trueSize = 0;
+        size_t tombstones = 0; // EAR buckets, they lengthen probes so enough of them trigger a rehash
+
+        static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+        size_t hash(const Key& key) const {
+            return Hash()(key) % currentCapacity;
+        }
+
+        void shuffleOffsets() {
+            offsets.resize(currentCapacity - 1);
+            std::iota(offsets.begin(), offsets.end(), 1);
+            std::random_device rd;
+            std::mt19937 gen(rd());
+            std::shuffle(offsets.begin(), offsets.end(), gen);
+        }
+
+        // index of the NORMAL bucket holding key, NOT_FOUND if there isn't one
+        size_t locate(const Key& key) const {
+            size_t home = hash(key);
+            for (size_t i = 0; i <= offsets.size(); ++i) {
+                size_t index = (i == 0) ? home : (home + offsets[i - 1]) % currentCapacity;
+                const Bucket& probe = buckets[index];
+
+                if (probe.type == BucketType::ESS) {
+                    return NOT_FOUND; // empty since start, can't be further along
+                }
+                if (probe.type == BucketType::NORMAL && probe.key == key) {
+                    return index;
+                }
+            }
+            return NOT_FOUND;
+        }
+};
+
+#endif
@@ -0,0 +1,418 @@
+/**
+ * HashTableLog.cpp
+ */
+
+#include "HashTableLog.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+    constexpr const char* MANIFEST = "MANIFEST";
+    // op + key length + value + deadline around the key bytes
+    constexpr size_t FIXED_PAYLOAD = 1 + 4 + 8 + 8;
+
+    uint32_t checksum(const char* data, size_t length) {
+        // FNV-1a, only has to catch a torn tail
+        uint32_t h = 2166136261U;
+        for (size_t i = 0; i < length; ++i) {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= 16777619U;
+        }
+        return h;
+    }
+
+    template <typename T>
+    void put(std::string& out, T x) {
+        out.append(reinterpret_cast<const char*>(&x), sizeof(T));
+    }
+
+    template <typename T>
+    T take(const char* p) {
+        T x;
+        std::memcpy(&x, p, sizeof(T));
+        return x;
+    }
+
+    [[noreturn]] void fail(const std::string& what) {
+        throw std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    void writeAll(int fd, const std::string& data, const std::string& path) {
+        size_t done = 0;
+        while (done < data.size()) {
+            ssize_t n = ::write(fd, data.data() + done, data.size() - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                fail("write " + path);
+            }
+            done += static_cast<size_t>(n);
+        }
+    }
+
+    // tmp file, sync, rename - readers only ever see the old file or the whole new one
+    void replaceFile(const std::string& path, const std::string& data) {
+        std::string tmp = path + ".tmp";
+        int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            fail("open " + tmp);
+        }
+        try {
+            writeAll(fd, data, tmp);
+            if (::fdatasync(fd) != 0) {
+                fail("fdatasync " + tmp);
+            }
+        } catch (...) {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        if (::rename(tmp.c_str(), path.c_str()) != 0) {
+            fail("rename " + tmp);
+        }
+    }
+
+    void syncDirectory(const std::string& dir) {
+        int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fsync(fd); // best effort, some filesystems refuse
+            ::close(fd);
+        }
+    }
+
+    std::string readFile(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+}
+
+HashTableLog::HashTableLog(const std::string& dir) : directory(dir) {
+    std::filesystem::create_directories(directory);
+    readManifest();
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() > 8 && name.compare(0, 4, "log-") == 0 && name.compare(name.size() - 4, 4, ".wal") == 0) {
+            logFiles[std::stoull(name.substr(4, name.size() - 8))] = entry.path().string();
+        }
+    }
+    writer = std::thread([this] { writerLoop(); });
+}
+
+HashTableLog::~HashTableLog() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    writer.join();
+    if (logFd >= 0) {
+        ::close(logFd);
+    }
+}
+
+bool HashTableLog::empty() const {
+    return logFiles.empty() && segments.empty();
+}
+
+size_t HashTableLog::capacityHint() const {
+    return generations.empty() ? 0 : generations.rbegin()->second.capacity;
+}
+
+void HashTableLog::replay(const std::function<void(const LogRecord&)>& apply) {
+    // later segments win, a key can be in an old layout's segment and a newer one
+    std::vector<std::pair<uint64_t, std::string>> order;
+    uint64_t newest = replayFrom;
+    for (const auto& [id, lsn] : segments) {
+        order.emplace_back(lsn, segmentPath(id.first, id.second));
+        newest = std::max(newest, lsn);
+    }
+    std::sort(order.begin(), order.end());
+
+    LogRecord record;
+    for (const auto& [lsn, path] : order) {
+        std::string bytes = readFile(path);
+        size_t pos = 0;
+        while (decode(bytes, pos, record)) {
+            apply(record);
+        }
+    }
+
+    // records are full states, so replaying from the oldest segment fixes up everything newer ones caught
+    for (const auto& [first, path] : logFiles) {
+        std::string bytes = readFile(path);
+        size_t pos = 0;
+        uint64_t lsn = first - 1;
+        while (decode(bytes, pos, record)) {
+            if (++lsn > replayFrom) {
+                apply(record);
+            }
+        }
+        // a torn tail is dropped, the next file (if any) knows where it starts
+        newest = std::max(newest, lsn);
+    }
+
+    std::lock_guard<std::mutex> guard(mutex);
+    appended = durable = newest;
+}
+
+uint64_t HashTableLog::append(LogOp op, std::string_view key, uint64_t value, int64_t deadline) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pending.size() >= MAX_PENDING_BYTES) {
+        // disk can't keep up, slow the writer down instead of queueing without bound
+        written.wait(lock, [this] { return pending.size() < MAX_PENDING_BYTES || !error.empty(); });
+    }
+    checkError();
+    bool first = pending.empty(); // otherwise the writer has already been told
+    encode(pending, op, key, value, deadline);
+    uint64_t lsn = ++appended;
+    lock.unlock();
+    if (first) {
+        wake.notify_one();
+    }
+    return lsn;
+}
+
+void HashTableLog::sync() {
+    std::unique_lock<std::mutex> lock(mutex);
+    uint64_t target = appended;
+    hurry = true; // someone is waiting, don't sit out the rest of the window
+    wake.notify_one();
+    written.wait(lock, [&] { return (durable >= target && jobs.empty() && !busy) || !error.empty(); });
+    checkError();
+}
+
+uint64_t HashTableLog::newGeneration() {
+    std::lock_guard<std::mutex> guard(mutex);
+    return nextGeneration++;
+}
+
+void HashTableLog::writeSegment(uint64_t gen, size_t index, size_t rangeCount, size_t capacity, std::string bytes) {
+    std::unique_lock<std::mutex> lock(mutex);
+    checkError();
+    jobs.push_back(SegmentJob{gen, index, rangeCount, capacity, appended, std::move(bytes)});
+    lock.unlock();
+    wake.notify_one();
+}
+
+uint64_t HashTableLog::lastLsn() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return appended;
+}
+
+uint64_t HashTableLog::replayLsn() const {
+    std::lock_guard<std::mutex> guard(mutex);
+    return replayFrom;
+}
+
+void HashTableLog::encode(std::string& out, LogOp op, std::string_view key, uint64_t value, int64_t deadline) {
+    size_t start = out.size();
+    put<uint32_t>(out, static_cast<uint32_t>(FIXED_PAYLOAD + key.size()));
+    put<uint32_t>(out, 0); // checksum, filled in below
+    put<uint8_t>(out, static_cast<uint8_t>(op));
+    put<uint32_t>(out, static_cast<uint32_t>(key.size()));
+    out.append(key);
+    put<uint64_t>(out, value);
+    put<int64_t>(out, deadline);
+    uint32_t sum = checksum(out.data() + start + 8, out.size() - start - 8);
+    std::memcpy(out.data() + start + 4, &sum, 4);
+}
+
+bool HashTableLog::decode(const std::string& in, size_t& pos, LogRecord& record) {
+    if (in.size() - pos < 8) {
+        return false;
+    }
+    const char* p = in.data() + pos;
+    uint32_t length = take<uint32_t>(p);
+    if (length < FIXED_PAYLOAD || in.size() - pos - 8 < length || take<uint32_t>(p + 4) != checksum(p + 8, length)) {
+        return false;
+    }
+    p += 8;
+    uint32_t keyLength = take<uint32_t>(p + 1);
+    if (keyLength != length - FIXED_PAYLOAD) {
+        return false;
+    }
+    record.op = static_cast<LogOp>(p[0]);
+    record.key = std::string_view(p + 5, keyLength);
+    record.value = take<uint64_t>(p + 5 + keyLength);
+    record.deadline = take<int64_t>(p + 13 + keyLength);
+    pos += 8 + length;
+    return true;
+}
+
+void HashTableLog::writerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stopping || !pending.empty() || !jobs.empty(); });
+        if (pending.empty() && jobs.empty()) {
+            return; // stopping and nothing left
+        }
+        // let a batch build up, one fdatasync per record would make the disk the limit
+        wake.wait_for(lock, GROUP_COMMIT_WINDOW, [this] {
+            return stopping || hurry || pending.size() >= GROUP_COMMIT_BYTES;
+        });
+        hurry = false;
+
+        // take everything that piled up, appends carry on into a fresh buffer meanwhile
+        std::string batch;
+        batch.swap(pending);
+        std::vector<SegmentJob> todo;
+        todo.swap(jobs);
+        uint64_t last = appended;
+        uint64_t first = durable + 1;
+        busy = true;
+        lock.unlock();
+        written.notify_all(); // room for appends that were waiting
+
+        std::string failure;
+        try {
+            if (!batch.empty()) {
+                writeBatch(first, batch);
+            }
+            // after the log batch, so a segment's records are never behind it on disk
+            if (!todo.empty()) {
+                writeSegments(todo);
+            }
+        } catch (const std::exception& e) {
+            failure = e.what();
+        }
+
+        lock.lock();
+        if (!failure.empty() && error.empty()) {
+            error = failure;
+        }
+        durable = last;
+        busy = false;
+        written.notify_all();
+    }
+}
+
+void HashTableLog::writeBatch(uint64_t first, const std::string& batch) {
+    if (logFd >= 0 && logBytes >= LOG_FILE_BYTES) {
+        ::close(logFd);
+        logFd = -1;
+    }
+    if (logFd < 0) {
+        // every run (and every full file) gets its own file, named after its first record
+        // one left over under the same name can only hold a torn record, so truncating loses nothing
+        std::string path = logPath(first);
+        logFd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (logFd < 0) {
+            fail("open " + path);
+        }
+        logFiles[first] = path;
+        logBytes = 0;
+        syncDirectory(directory);
+    }
+    writeAll(logFd, batch, logFiles.rbegin()->second);
+    if (::fdatasync(logFd) != 0) {
+        fail("fdatasync log");
+    }
+    logBytes += batch.size();
+}
+
+void HashTableLog::writeSegments(std::vector<SegmentJob>& todo) {
+    for (auto& job : todo) {
+        replaceFile(segmentPath(job.gen, job.index), job.bytes);
+        segments[{job.gen, job.index}] = job.lsn;
+        generations[job.gen] = Generation{job.rangeCount, job.capacity};
+    }
+    checkpoint();
+}
+
+void HashTableLog::checkpoint() {
+    // newest generation with a segment for every range
+    uint64_t complete = 0;
+    for (const auto& [gen, info] : generations) {
+        auto first = segments.lower_bound({gen, 0});
+        auto last = segments.lower_bound({gen + 1, 0});
+        if (static_cast<size_t>(std::distance(first, last)) == info.rangeCount) {
+            complete = gen;
+        }
+    }
+
+    std::vector<std::string> obsolete;
+    uint64_t from = 0;
+    if (complete != 0) {
+        // everything in an older layout is covered by the complete one
+        for (auto it = segments.begin(); it != segments.end() && it->first.first < complete;) {
+            obsolete.push_back(segmentPath(it->first.first, it->first.second));
+            it = segments.erase(it);
+        }
+        generations.erase(generations.begin(), generations.lower_bound(complete));
+        from = UINT64_MAX;
+        for (const auto& [id, lsn] : segments) {
+            from = std::min(from, lsn);
+        }
+    }
+
+    std::ostringstream manifest;
+    manifest << "hashtable-manifest 1\n";
+    manifest << "replay " << from << "\n";
+    for (const auto& [gen, info] : generations) {
+        manifest << "generation " << gen << " " << info.rangeCount << " " << info.capacity << "\n";
+    }
+    for (const auto& [id, lsn] : segments) {
+        manifest << "segment " << id.first << " " << id.second << " " << lsn << "\n";
+    }
+    replaceFile(directory + "/" + MANIFEST, manifest.str());
+    syncDirectory(directory);
+
+    // only delete once the manifest no longer points at it
+    for (const auto& path : obsolete) {
+        std::filesystem::remove(path);
+    }
+    // a log file is done with once the next one starts at or before the replay point
+    while (logFiles.size() > 1 && std::next(logFiles.begin())->first <= from + 1) {
+        std::filesystem::remove(logFiles.begin()->second);
+        logFiles.erase(logFiles.begin());
+    }
+
+    std::lock_guard<std::mutex> guard(mutex);
+    replayFrom = from;
+}
+
+void HashTableLog::readManifest() {
+    std::ifstream in(directory + "/" + MANIFEST);
+    std::string word;
+    while (in >> word) {
+        if (word == "replay") {
+            in >> replayFrom;
+        } else if (word == "generation") {
+            uint64_t gen;
+            Generation info;
+            in >> gen >> info.rangeCount >> info.capacity;
+            generations[gen] = info;
+            nextGeneration = std::max(nextGeneration, gen + 1);
+        } else if (word == "segment") {
+            uint64_t gen, lsn;
+            size_t index;
+            in >> gen >> index >> lsn;
+            segments[{gen, index}] = lsn;
+        } else {
+            in >> word; // header
+        }
+    }
+}
+
+void HashTableLog::checkError() const {
+    if (!error.empty()) {
+        throw std::runtime_error("Log write failed: " + error);
+    }
+}
+
+std::string HashTableLog::segmentPath(uint64_t gen, size_t index) const {
+    return directory + "/seg-" + std::to_string(gen) + "-" + std::to_string(index) + ".snap";
+}
+
+std::string HashTableLog::logPath(uint64_t first) const {
+    return directory + "/log-" + std::to_string(first) + ".wal";
+}
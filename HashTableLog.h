@@ -0,0 +1,147 @@
+/**
+ * HashTableLog.h
+ */
+
+#ifndef HASHTABLELOG_H
+#define HASHTABLELOG_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// what a log record does to the table when replayed
+// PUT - key ends up holding value (and deadline), whether or not it was there,
+// REMOVE - key is gone,
+// CLEAR - everything is gone
+enum class LogOp : uint8_t {
+    PUT = 1, REMOVE = 2, CLEAR = 3
+};
+
+// one decoded record, key points into the buffer it was read from
+// deadline is wall clock nanoseconds since the epoch (steady_clock doesn't survive a restart), 0 = no TTL
+struct LogRecord {
+    LogOp op;
+    std::string_view key;
+    uint64_t value;
+    int64_t deadline;
+};
+
+// durability for a HashTable, everything lives in one directory:
+// log-<first lsn>.wal - append only change records, numbered 1, 2, ... (the LSN) across files
+// seg-<generation>-<range>.snap - copy of one range of buckets, taken at some LSN
+// MANIFEST - which segments are current and the LSN recovery replays the log from
+//
+// callers append records and hand over segments; a background thread writes both out, every batch
+// is one write + fdatasync for everything appended during the group commit window and the last sync
+// a generation is one bucket layout - once every range of a generation has a segment, older
+// generations and the log before the oldest of those segments are deleted
+class HashTableLog {
+    public:
+        // opens dir (creating it if needed) and picks up whatever an earlier run left there
+        explicit HashTableLog(const std::string& dir);
+        // writes out everything appended so far before returning
+        ~HashTableLog();
+
+        HashTableLog(const HashTableLog&) = delete;
+        HashTableLog& operator=(const HashTableLog&) = delete;
+
+        // nothing from an earlier run in the directory
+        bool empty() const;
+        // table capacity of the newest snapshot, 0 if there isn't one
+        size_t capacityHint() const;
+        // feed apply every snapshot entry (oldest segment first) then every log record after them
+        // has to run before the first append on a directory that isn't empty
+        void replay(const std::function<void(const LogRecord&)>& apply);
+
+        // queue a record, returns its LSN; doesn't wait for the disk
+        uint64_t append(LogOp op, std::string_view key, uint64_t value, int64_t deadline);
+        // block until everything appended so far is on disk
+        void sync();
+
+        // generation number for a new bucket layout
+        uint64_t newGeneration();
+        // queue bytes (PUT records from encode) as the segment for range index of generation gen
+        // the segment counts as taken at the LSN of the last append before this call
+        void writeSegment(uint64_t gen, size_t index, size_t rangeCount, size_t capacity, std::string bytes);
+
+        // LSN of the last append
+        uint64_t lastLsn() const;
+        // where recovery would start replaying the log right now
+        uint64_t replayLsn() const;
+
+        // frame one record onto out: u32 length, u32 checksum, op, u32 key length, key, u64 value, i64 deadline
+        static void encode(std::string& out, LogOp op, std::string_view key, uint64_t value, int64_t deadline);
+        // read one record at pos, false at the end or at a torn/corrupt record
+        static bool decode(const std::string& in, size_t& pos, LogRecord& record);
+
+        // a full log file starts a new one
+        static constexpr size_t LOG_FILE_BYTES = size_t(64) << 20;
+        // the writer waits this long after the first record of a batch for more to show up,
+        // cut short by sync() or once GROUP_COMMIT_BYTES are queued
+        static constexpr std::chrono::microseconds GROUP_COMMIT_WINDOW{1000};
+        static constexpr size_t GROUP_COMMIT_BYTES = size_t(1) << 20;
+        // appends wait for the writer once this much is queued
+        static constexpr size_t MAX_PENDING_BYTES = size_t(64) << 20;
+
+    private:
+        struct SegmentJob {
+            uint64_t gen;
+            size_t index;
+            size_t rangeCount;
+            size_t capacity;
+            uint64_t lsn;
+            std::string bytes;
+        };
+        struct Generation {
+            size_t rangeCount = 0;
+            size_t capacity = 0;
+        };
+
+        std::string directory;
+
+        // shared with the writer thread, all under mutex
+        mutable std::mutex mutex;
+        std::condition_variable wake; // writer waits on this for work
+        std::condition_variable written; // sync() and full appends wait on this
+        std::string pending; // encoded records not handed to the writer yet
+        std::vector<SegmentJob> jobs;
+        uint64_t appended = 0; // last LSN handed out
+        uint64_t durable = 0; // last LSN on disk
+        uint64_t nextGeneration = 1;
+        std::string error; // first write failure, rethrown on the caller's side
+        bool stopping = false;
+        bool busy = false; // writer is working on something it took
+        bool hurry = false; // sync() is waiting, end the group commit window now
+
+        // only touched by the writer thread (and by the constructor/replay before it has work)
+        int logFd = -1;
+        size_t logBytes = 0;
+        std::map<uint64_t, std::string> logFiles; // first LSN -> path
+        std::map<std::pair<uint64_t, size_t>, uint64_t> segments; // (generation, range) -> LSN
+        std::map<uint64_t, Generation> generations;
+        uint64_t replayFrom = 0; // guarded by mutex too, replayLsn() reads it
+
+        std::thread writer;
+
+        void writerLoop();
+        void writeBatch(uint64_t first, const std::string& batch);
+        void writeSegments(std::vector<SegmentJob>& todo);
+        // recompute what recovery needs, rewrite MANIFEST, delete what it doesn't need any more
+        void checkpoint();
+        void readManifest();
+        void checkError() const;
+
+        std::string segmentPath(uint64_t gen, size_t index) const;
+        std::string logPath(uint64_t first) const;
+};
+
+#endif
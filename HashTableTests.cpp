@@ -19,9 +19,18 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <array>
 #include <type_traits>
 #include <optional>
 #include <string>
+#include <memory>
+#include <memory_resource>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <thread>
 
 using namespace std;
 
@@ -40,6 +49,17 @@ using HashTable = HashTable_t<key_type, value_type>;
 #else
 #include "HashTable.h" // Must match key_type/value_type of the tested HashTable
 #endif
+// the tables and extras below are built on the real HashTable, so USE_IMPL runs the basic tests only
+#ifndef USE_IMPL
+#include "CuckooHashTable.h"
+#include "FixedHashTable.h"
+#include "FrozenHashTable.h"
+#include "HashTableAsync.h"
+#include "HashTableImpl.h"
+#include "HugePageResource.h"
+#include "IntHashTable.h"
+#include "ThreadPool.h"
+#endif
 
 // -----------------------------------------------------------------------------
 /** Helpers: make_key / make_value
@@ -68,6 +88,17 @@ requires std::is_integral_v<IndexType>
         return static_cast<ValueType>(i + 1);
 }
 
+#ifndef USE_IMPL
+// -----------------------------------------------------------------------------
+// Coroutine used by the get_async test: looks up every stride-th key starting at first
+// -----------------------------------------------------------------------------
+LookupTask lookup_stripe(const HashTable& ht, LookupScheduler& sched, const vector<string>& keys,
+                         size_t first, size_t stride, vector<optional<size_t>>& out) {
+    for (size_t i = first; i < keys.size(); i += stride)
+        out[i] = co_await ht.get_async(keys[i], sched);
+}
+#endif
+
 // -----------------------------------------------------------------------------
 // Output routing and test toggles
 // -----------------------------------------------------------------------------
@@ -102,6 +133,24 @@ const string evalName{""};
 #define HT_ALPHA
 #define HT_CAPACITY
 #define HT_SIZE
+#ifndef USE_IMPL
+#define HT_PARALLEL_REHASH
+#define HT_KEY_ARENA
+#define HT_HUGE_PAGES
+#define HT_INT_KEYS
+#define HT_FIXED
+#define HT_FREEZE
+#define HT_CUCKOO
+#define HT_TTL
+#define HT_CLOCK_EVICTION
+#define HT_FILTER
+#define HT_ASYNC_GET
+#define HT_LOG
+#define HT_MEMORY
+#define HT_BULK
+#define HT_HARDENED
+#define HT_VALUE_TYPES
+#endif
 
 // -----------------------------------------------------------------------------
 // Main
@@ -709,6 +758,1001 @@ int main(int, char**) {
     OUTSTREAM << "*** DID NOT TEST SIZE ***" << endl << endl;
 #endif
 
+    // =====================================================================
+    // PARALLEL REHASH
+    // =====================================================================
+    OUTSTREAM << "Testing rehash()/reserve() spread over a ThreadPool" << endl;
+    OUTSTREAM << "---------------------------------------------------" << endl << endl;
+#ifdef HT_PARALLEL_REHASH
+    try {
+        // needs distinct keys well past the serial cutoff, make_key only has 26 strings
+        constexpr size_t COUNT = 100000;
+        ThreadPool pool(4);
+        HashTable ht1;
+        ht1.setThreadPool(&pool);
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT << " entries (several parallel resizes)..." << endl;
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= ht1.insert(to_string(i), i);
+        OUTSTREAM << "  size() = " << ht1.size() << ", capacity() = " << ht1.capacity() << endl;
+
+        OUTSTREAM << "Calling reserve(" << COUNT * 2 << ") and rehash(" << COUNT << ")..." << endl;
+        ht1.reserve(COUNT * 2);
+        OUTSTREAM << "  capacity() after reserve = " << ht1.capacity() << endl;
+        ok &= ht1.capacity() > COUNT * 4;
+        ht1.rehash(COUNT);
+        OUTSTREAM << "  capacity() after rehash = " << ht1.capacity() << endl;
+        ok &= ht1.capacity() > COUNT * 2;
+
+        OUTSTREAM << "Verifying every entry survived..." << endl;
+        for (size_t i = 0; i < COUNT; i++) {
+            auto res = ht1.get(to_string(i));
+            ok &= (res && *res == i);
+        }
+        ok &= (ht1.size() == COUNT);
+
+        OUTSTREAM << "Rehashing two tables on the same pool from two threads at once..." << endl;
+        constexpr size_t SHARED = 20000;
+        HashTable ht2, ht3;
+        ht2.setThreadPool(&pool);
+        ht3.setThreadPool(&pool);
+        for (size_t i = 0; i < SHARED; i++) {
+            ht2.insert(to_string(i), i);
+            ht3.insert(to_string(i), i + 1);
+        }
+        auto churn = [&](HashTable& ht) {
+            for (int round = 0; round < 20; round++) {
+                ht.rehash(ht.capacity() * 2);
+                ht.rehash(SHARED);
+            }
+        };
+        thread first(churn, ref(ht2));
+        thread second(churn, ref(ht3));
+        first.join();
+        second.join();
+        for (size_t i = 0; i < SHARED; i++) {
+            auto a = ht2.get(to_string(i));
+            auto b = ht3.get(to_string(i));
+            ok &= (a && *a == i && b && *b == i + 1);
+        }
+        ok &= (ht2.size() == SHARED && ht3.size() == SHARED);
+        OUTSTREAM << (ok ? "SUCCESS: all entries found with correct values after parallel rehash."
+                         : "FAILURE: entries lost or changed during parallel rehash.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST PARALLEL REHASH ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // KEY ARENA
+    // =====================================================================
+    OUTSTREAM << "Testing pooled key arena, removal churn and clear()" << endl;
+    OUTSTREAM << "---------------------------------------------------" << endl << endl;
+#ifdef HT_KEY_ARENA
+    try {
+        // long keys so they actually leave SSO and go through the arena
+        auto longKey = [](size_t i) { return "session-key-with-plenty-of-padding-" + to_string(i); };
+        constexpr size_t COUNT = 2000;
+        HashTable ht1(8, std::pmr::new_delete_resource());
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT << " long keys, removing the even ones..." << endl;
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= ht1.insert(longKey(i), i);
+        for (size_t i = 0; i < COUNT; i += 2)
+            ok &= ht1.remove(longKey(i));
+
+        OUTSTREAM << "Reinserting into the freed slots..." << endl;
+        for (size_t i = COUNT; i < COUNT + COUNT / 2; i++)
+            ok &= ht1.insert(longKey(i), i);
+        for (size_t i = 1; i < COUNT + COUNT / 2; i++) {
+            bool expected = (i >= COUNT) || (i % 2 == 1);
+            ok &= (ht1.contains(longKey(i)) == expected);
+        }
+        OUTSTREAM << "  size() = " << ht1.size() << endl;
+        ok &= (ht1.size() == COUNT);
+
+        size_t cap = ht1.capacity();
+        OUTSTREAM << "Calling clear()..." << endl;
+        ht1.clear();
+        OUTSTREAM << "  size() = " << ht1.size() << ", capacity() = " << ht1.capacity() << endl;
+        ok &= (ht1.size() == 0 && ht1.capacity() == cap && !ht1.contains(longKey(1)));
+
+        OUTSTREAM << "Inserting again after clear()..." << endl;
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= ht1.insert(longKey(i), i + 1);
+        ok &= (ht1.get(longKey(7)) == 8);
+
+        OUTSTREAM << "Copying it, changing the copy, then copy and move assigning over live tables..." << endl;
+        {
+            HashTable copy = ht1;
+            ok &= copy.remove(longKey(7)) && copy.insert(longKey(COUNT), 1);
+            ok &= (ht1.get(longKey(7)) == 8 && !ht1.contains(longKey(COUNT)));
+            ok &= (copy.size() == COUNT && copy.get(longKey(8)) == 9);
+
+            HashTable other(8, std::pmr::new_delete_resource());
+            other.insert(longKey(1), 100);
+            other = copy;
+            ok &= (other.size() == COUNT && other.get(longKey(1)) == 2 && !other.contains(longKey(7)));
+            HashTable plain;
+            plain.insert("short", 1);
+            HashTable plainCopy = plain;
+            plainCopy = ht1; // plain table takes over a copy of the arena one
+            ok &= (plainCopy.size() == COUNT && !plainCopy.contains("short") && plainCopy.get(longKey(7)) == 8);
+            other = std::move(plain);
+            ok &= (other.size() == 1 && other.get("short") == 1);
+        }
+        ok &= (ht1.size() == COUNT && ht1.get(longKey(COUNT - 1)) == COUNT);
+
+        OUTSTREAM << (ok ? "SUCCESS: arena-backed table behaved like the default one."
+                         : "FAILURE: arena-backed table lost or kept the wrong entries.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST KEY ARENA ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // HUGE PAGE BUCKETS
+    // =====================================================================
+    OUTSTREAM << "Testing buckets backed by HugePageResource" << endl;
+    OUTSTREAM << "------------------------------------------" << endl << endl;
+#ifdef HT_HUGE_PAGES
+    try {
+        constexpr size_t COUNT = 5000;
+        HugePageResource pages(HugePageMode::EXPLICIT, NumaPolicy::INTERLEAVE);
+        bool ok = true;
+        {
+            HashTable ht1(8, std::pmr::new_delete_resource(), &pages);
+            OUTSTREAM << "Inserting " << COUNT << " entries..." << endl;
+            for (size_t i = 0; i < COUNT; i++)
+                ok &= ht1.insert(to_string(i), i);
+            for (size_t i = 0; i < COUNT; i++)
+                ok &= (ht1.get(to_string(i)) == i);
+
+            OUTSTREAM << "  mapped " << pages.bytesMapped() << " bytes, hugetlb fallbacks "
+                      << pages.hugeTlbFallbacks() << ", mbind failures " << pages.numaFailures() << endl;
+            ok &= (pages.bytesMapped() > 0 && pages.bytesMapped() % HugePageResource::HUGE_PAGE_SIZE == 0);
+        }
+        OUTSTREAM << "Destroyed table, mapped bytes now " << pages.bytesMapped() << endl;
+        ok &= (pages.bytesMapped() == 0);
+
+        OUTSTREAM << (ok ? "SUCCESS: huge page buckets held every entry and were unmapped afterwards."
+                         : "FAILURE: huge page backed table misbehaved.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST HUGE PAGES ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // INTEGER KEYS
+    // =====================================================================
+    OUTSTREAM << "Testing IntHashTable (packed uint64 slots, sentinel keys)" << endl;
+    OUTSTREAM << "---------------------------------------------------------" << endl << endl;
+#ifdef HT_INT_KEYS
+    try {
+        constexpr uint64_t COUNT = 10000;
+        IntHashTable ht1;
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT << " keys plus both sentinel values as real keys..." << endl;
+        for (uint64_t i = 0; i < COUNT; i++)
+            ok &= ht1.insert(i * 7919, i);
+        ok &= ht1.insert(IntHashTable::EMPTY_KEY, 1);
+        ok &= ht1.insert(IntHashTable::TOMBSTONE_KEY, 2);
+        ok &= !ht1.insert(IntHashTable::EMPTY_KEY, 3); // duplicate
+        OUTSTREAM << "  size() = " << ht1.size() << ", capacity() = " << ht1.capacity() << endl;
+        ok &= (ht1.size() == COUNT + 2);
+
+        OUTSTREAM << "Removing every other key, then churning through the tombstones..." << endl;
+        for (uint64_t i = 0; i < COUNT; i += 2)
+            ok &= ht1.remove(i * 7919);
+        for (uint64_t round = 0; round < 5; round++) {
+            for (uint64_t i = 0; i < COUNT; i += 2)
+                ok &= ht1.insert(i * 7919 + 1, round);
+            for (uint64_t i = 0; i < COUNT; i += 2)
+                ok &= ht1.remove(i * 7919 + 1);
+        }
+        OUTSTREAM << "  capacity() after churn = " << ht1.capacity() << endl;
+
+        OUTSTREAM << "Verifying contents..." << endl;
+        for (uint64_t i = 0; i < COUNT; i++) {
+            auto res = ht1.get(i * 7919);
+            ok &= (i % 2 == 0) ? !res.has_value() : (res && *res == i);
+        }
+        ok &= (ht1.get(IntHashTable::EMPTY_KEY) == 1u && ht1[IntHashTable::TOMBSTONE_KEY] == 2u);
+        ht1[IntHashTable::EMPTY_KEY] = 9;
+        ok &= (ht1.get(IntHashTable::EMPTY_KEY) == 9u);
+        ok &= ht1.remove(IntHashTable::TOMBSTONE_KEY) && !ht1.contains(IntHashTable::TOMBSTONE_KEY);
+        ok &= (ht1.keys().size() == ht1.size() && ht1.size() == COUNT / 2 + 1);
+
+        OUTSTREAM << (ok ? "SUCCESS: IntHashTable matched expected contents, sentinel keys included."
+                         : "FAILURE: IntHashTable contents wrong.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST INT KEYS ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // FIXED / CONSTEXPR TABLE
+    // =====================================================================
+    OUTSTREAM << "Testing FixedHashTable built at compile time" << endl;
+    OUTSTREAM << "--------------------------------------------" << endl << endl;
+#ifdef HT_FIXED
+    try {
+        // built entirely by the compiler, the static_asserts run during the build
+        static constexpr FixedHashTable<16> codes{{"GET", 1}, {"PUT", 2}, {"POST", 3}, {"DELETE", 4}, {"GET", 99}};
+        static_assert(codes.size() == 4, "duplicate literal should be ignored");
+        static_assert(codes.get("POST") == 3u, "constexpr get");
+        static_assert(codes.get("GET") == 1u, "first value wins");
+        static_assert(!codes.contains("PATCH"), "constexpr miss");
+
+        OUTSTREAM << "Compile time table:" << endl << codes;
+        bool ok = true;
+
+        OUTSTREAM << "Copying to a runtime table and filling it to capacity..." << endl;
+        FixedHashTable<16> ht1 = codes;
+        vector<string> extra;
+        for (size_t i = 0; i < 12; i++)
+            extra.push_back("K" + to_string(i));
+        for (auto& k : extra)
+            ok &= ht1.insert(k, 100);
+        OUTSTREAM << "  size() = " << ht1.size() << ", alpha() = " << ht1.alpha() << endl;
+        ok &= (ht1.size() == 16);
+        ok &= !ht1.insert("overflow", 1); // full, no resize
+        ok &= ht1.remove("PUT") && !ht1.contains("PUT");
+        ok &= ht1.insert("overflow", 1) && (ht1.get("overflow") == 1u);
+        ht1["GET"] = 7;
+        ok &= (ht1.get("GET") == 7u && ht1.keys().size() == 16);
+
+        OUTSTREAM << (ok ? "SUCCESS: FixedHashTable worked at compile time and at runtime."
+                         : "FAILURE: FixedHashTable returned unexpected results.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST FIXED ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // FREEZE
+    // =====================================================================
+    OUTSTREAM << "Testing HashTable::freeze() perfect hash table" << endl;
+    OUTSTREAM << "----------------------------------------------" << endl << endl;
+#ifdef HT_FREEZE
+    try {
+        constexpr size_t COUNT = 20000;
+        HashTable ht1;
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT << " entries, removing a few, then freezing..." << endl;
+        for (size_t i = 0; i < COUNT; i++)
+            ht1.insert(to_string(i), i * 3);
+        for (size_t i = 0; i < COUNT; i += 10)
+            ht1.remove(to_string(i));
+        FrozenHashTable frozen = ht1.freeze();
+        OUTSTREAM << "  size() = " << frozen.size() << ", capacity() = " << frozen.capacity()
+                  << ", alpha() = " << frozen.alpha() << ", pilot bytes = " << frozen.pilotBytes() << endl;
+        ok &= (frozen.size() == ht1.size() && frozen.alpha() > .95);
+
+        OUTSTREAM << "Checking every key, removed keys and never inserted keys..." << endl;
+        for (size_t i = 0; i < COUNT; i++) {
+            auto res = frozen.get(to_string(i));
+            ok &= (i % 10 == 0) ? !res.has_value() : (res && *res == i * 3);
+        }
+        for (size_t i = COUNT; i < 2 * COUNT; i++)
+            ok &= !frozen.contains(to_string(i));
+        ok &= (frozen.keys().size() == frozen.size());
+
+        // libstdc++ hashes strings 8 bytes at a time with h = (h ^ d(block)) * M, and d can be undone,
+        // so a second block can cancel out the difference the first one made - two 16 byte keys, one std::hash
+        OUTSTREAM << "Freezing two keys with the same std::hash..." << endl;
+        constexpr uint64_t M = 0xc6a4a7935bd1e995ULL;
+        uint64_t inverse = M;
+        for (int i = 0; i < 5; i++)
+            inverse *= 2 - M * inverse;
+        auto d = [&](uint64_t x) { x *= M; return (x ^ (x >> 47)) * M; };
+        auto undo = [&](uint64_t y) { y *= inverse; return (y ^ (y >> 47)) * inverse; };
+        auto block = [](string& key, uint64_t x) { key.append(reinterpret_cast<const char*>(&x), 8); };
+        uint64_t start = 0xc70f6907ULL ^ (16 * M);
+        uint64_t a = 0x1111111111111111ULL, b = 0x2222222222222222ULL, c = 0x3333333333333333ULL;
+        uint64_t diff = ((start ^ d(a)) * M) ^ ((start ^ d(b)) * M);
+        string first, second;
+        block(first, a);
+        block(first, c);
+        block(second, b);
+        block(second, undo(d(c) ^ diff));
+        if (hash<string_view>()(first) != hash<string_view>()(second)) {
+            OUTSTREAM << "  (this standard library hashes strings differently, using two ordinary keys)" << endl;
+            second = "not-a-collision";
+        }
+        HashTable ht2;
+        ht2.insert(first, 1);
+        ht2.insert(second, 2);
+        FrozenHashTable pair = ht2.freeze();
+        ok &= (pair.size() == 2 && pair.get(first) == 1u && pair.get(second) == 2u);
+
+        OUTSTREAM << (ok ? "SUCCESS: frozen table answered hits and misses like the live one."
+                         : "FAILURE: frozen table disagreed with the live one.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST FREEZE ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // CUCKOO ENGINE
+    // =====================================================================
+    OUTSTREAM << "Testing CuckooHashTable (same API, two buckets per key)" << endl;
+    OUTSTREAM << "-------------------------------------------------------" << endl << endl;
+#ifdef HT_CUCKOO
+    try {
+        constexpr size_t COUNT = 20000;
+        CuckooHashTable ht1;
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT << " entries, duplicates rejected..." << endl;
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= ht1.insert(to_string(i), i);
+        for (size_t i = 0; i < COUNT; i += 100)
+            ok &= !ht1.insert(to_string(i), 0);
+        OUTSTREAM << "  size() = " << ht1.size() << ", capacity() = " << ht1.capacity()
+                  << ", alpha() = " << ht1.alpha() << ", stash = " << ht1.stashSize() << endl;
+        ok &= (ht1.size() == COUNT);
+
+        OUTSTREAM << "Removing a third, updating through operator[] and reinserting..." << endl;
+        for (size_t i = 0; i < COUNT; i += 3)
+            ok &= ht1.remove(to_string(i));
+        ok &= !ht1.remove(to_string(0));
+        for (size_t i = 1; i < COUNT; i += 3)
+            ht1[to_string(i)] += 1;
+        for (size_t i = COUNT; i < COUNT + COUNT / 2; i++)
+            ok &= ht1.insert(to_string(i), i);
+
+        OUTSTREAM << "Verifying contents..." << endl;
+        for (size_t i = 0; i < COUNT + COUNT / 2; i++) {
+            auto res = ht1.get(to_string(i));
+            if (i < COUNT && i % 3 == 0)
+                ok &= !res.has_value();
+            else
+                ok &= (res && *res == i + ((i < COUNT && i % 3 == 1) ? 1 : 0));
+        }
+        ok &= (ht1.keys().size() == ht1.size());
+
+        OUTSTREAM << (ok ? "SUCCESS: CuckooHashTable matched expected contents."
+                         : "FAILURE: CuckooHashTable contents wrong.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST CUCKOO ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // TTL / EXPIRING ENTRIES
+    // =====================================================================
+    OUTSTREAM << "Testing TTL entries, lazy expiry and the incremental sweeper" << endl;
+    OUTSTREAM << "------------------------------------------------------------" << endl << endl;
+#ifdef HT_TTL
+    try {
+        constexpr size_t COUNT = 200;
+        HashTable ht1;
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT << " entries with a 30 ms TTL and " << COUNT << " without..." << endl;
+        for (size_t i = 0; i < COUNT; i++) {
+            ok &= ht1.insert("ttl" + to_string(i), i, chrono::milliseconds(30));
+            ok &= ht1.insert("keep" + to_string(i), i);
+        }
+        ok &= ht1.contains("ttl7") && (ht1.get("ttl7") == 7u);
+        ok &= !ht1.insert("ttl7", 0, chrono::milliseconds(30)); // still alive, duplicate
+        ok &= ht1.expire("keep0", chrono::milliseconds(30)); // give one permanent entry a TTL
+
+        OUTSTREAM << "Sleeping past the TTL..." << endl;
+        this_thread::sleep_for(chrono::milliseconds(60));
+
+        size_t visible = 0;
+        for (size_t i = 0; i < COUNT; i++)
+            visible += ht1.contains("ttl" + to_string(i)) + ht1.get("ttl" + to_string(i)).has_value();
+        OUTSTREAM << "  expired entries still visible: " << visible << endl;
+        ok &= (visible == 0 && !ht1.contains("keep0") && ht1.contains("keep1"));
+        ok &= (ht1.keys().size() == COUNT - 1);
+
+        OUTSTREAM << "Reinserting one expired key, then letting normal traffic drive the sweeper..." << endl;
+        ok &= ht1.insert("ttl3", 33) && (ht1.get("ttl3") == 33u);
+        size_t before = ht1.size();
+        for (size_t i = 0; i < ht1.capacity(); i++) {
+            ht1.insert("churn", i);
+            ht1.remove("churn");
+        }
+        OUTSTREAM << "  size() before churn = " << before << ", after = " << ht1.size() << endl;
+        ok &= (ht1.size() == COUNT); // keep1..keep199 + ttl3
+
+        OUTSTREAM << "Explicit sweep() of a short TTL batch..." << endl;
+        for (size_t i = 0; i < 50; i++)
+            ht1.insert("short" + to_string(i), i, chrono::milliseconds(1));
+        this_thread::sleep_for(chrono::milliseconds(5));
+        size_t swept = ht1.sweep(ht1.capacity());
+        OUTSTREAM << "  sweep() reclaimed " << swept << endl;
+        ok &= (swept == 50 && ht1.size() == COUNT);
+
+        OUTSTREAM << (ok ? "SUCCESS: TTL entries expired lazily and were reclaimed by the sweeper."
+                         : "FAILURE: TTL entries misbehaved.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST TTL ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // BOUNDED SIZE / CLOCK EVICTION
+    // =====================================================================
+    OUTSTREAM << "Testing setMaxSize() with CLOCK eviction" << endl;
+    OUTSTREAM << "----------------------------------------" << endl << endl;
+#ifdef HT_CLOCK_EVICTION
+    try {
+        constexpr size_t LIMIT = 100;
+        HashTable ht1;
+        ht1.setMaxSize(LIMIT);
+        bool ok = true;
+
+        OUTSTREAM << "Filling to the limit of " << LIMIT << " and reading the first half..." << endl;
+        for (size_t i = 0; i < LIMIT; i++)
+            ok &= ht1.insert(to_string(i), i);
+        for (size_t i = 0; i < LIMIT / 2; i++)
+            ok &= ht1.get(to_string(i)).has_value();
+
+        OUTSTREAM << "Inserting 30 new keys past the limit..." << endl;
+        for (size_t i = LIMIT; i < LIMIT + 30; i++)
+            ok &= ht1.insert(to_string(i), i);
+        size_t hot = 0;
+        for (size_t i = 0; i < LIMIT / 2; i++)
+            hot += ht1.contains(to_string(i));
+        OUTSTREAM << "  size() = " << ht1.size() << ", evictions = " << ht1.stats().evictions
+                  << ", referenced keys kept = " << hot << "/" << LIMIT / 2 << endl;
+        ok &= (ht1.size() == LIMIT && ht1.stats().evictions == 30 && hot == LIMIT / 2);
+
+        OUTSTREAM << "Streaming 10000 one-off keys through, capacity must stay bounded..." << endl;
+        for (size_t i = 0; i < 10000; i++)
+            ht1.insert("stream" + to_string(i), i);
+        OUTSTREAM << "  size() = " << ht1.size() << ", capacity() = " << ht1.capacity() << endl;
+        ok &= (ht1.size() == LIMIT && ht1.capacity() <= 4 * LIMIT);
+
+        OUTSTREAM << "Lowering the limit to " << LIMIT / 4 << "..." << endl;
+        ht1.setMaxSize(LIMIT / 4);
+        ok &= (ht1.size() == LIMIT / 4);
+
+        OUTSTREAM << (ok ? "SUCCESS: size stayed at the limit and referenced entries survived."
+                         : "FAILURE: eviction mode misbehaved.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST CLOCK EVICTION ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // BLOOM PREFILTER
+    // =====================================================================
+    OUTSTREAM << "Testing the Bloom prefilter (setFilter) across removes and resizes" << endl;
+    OUTSTREAM << "------------------------------------------------------------------" << endl << endl;
+#ifdef HT_FILTER
+    try {
+        constexpr size_t COUNT = 5000;
+        HashTable ht1;
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT / 2 << " entries, enabling the filter, inserting " << COUNT / 2 << " more..." << endl;
+        for (size_t i = 0; i < COUNT / 2; i++)
+            ht1.insert(to_string(i), i);
+        ht1.setFilter(true);
+        for (size_t i = COUNT / 2; i < COUNT; i++)
+            ht1.insert(to_string(i), i);
+        ok &= ht1.hasFilter();
+
+        OUTSTREAM << "Removing every third key and reinserting some of them..." << endl;
+        for (size_t i = 0; i < COUNT; i += 3)
+            ok &= ht1.remove(to_string(i));
+        for (size_t i = 0; i < COUNT; i += 9)
+            ok &= ht1.insert(to_string(i), i + 1);
+
+        OUTSTREAM << "Checking hits, removed keys and never inserted keys..." << endl;
+        for (size_t i = 0; i < COUNT; i++) {
+            auto res = ht1.get(to_string(i));
+            if (i % 9 == 0)
+                ok &= (res && *res == i + 1);
+            else if (i % 3 == 0)
+                ok &= !res && !ht1.contains(to_string(i));
+            else
+                ok &= (res && *res == i && ht1.contains(to_string(i)));
+        }
+        for (size_t i = COUNT; i < 3 * COUNT; i++)
+            ok &= !ht1.contains(to_string(i)) && !ht1.remove(to_string(i));
+        bool threw = false;
+        try { ht1["missing"]; } catch (runtime_error&) { threw = true; }
+        ok &= threw;
+
+        OUTSTREAM << "Disabling the filter..." << endl;
+        ht1.setFilter(false);
+        ok &= !ht1.hasFilter() && ht1.contains("1") && !ht1.contains("3");
+
+        OUTSTREAM << (ok ? "SUCCESS: filtered table answered exactly like an unfiltered one."
+                         : "FAILURE: filter caused a wrong answer.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST FILTER ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // ASYNC GET
+    // =====================================================================
+    OUTSTREAM << "Testing get_async() coroutines on a LookupScheduler" << endl;
+    OUTSTREAM << "---------------------------------------------------" << endl << endl;
+#ifdef HT_ASYNC_GET
+    try {
+        constexpr size_t COUNT = 4000;
+        constexpr size_t IN_FLIGHT = 16;
+        HashTable ht1;
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT << " entries, looking up twice as many keys..." << endl;
+        vector<string> lookups;
+        for (size_t i = 0; i < 2 * COUNT; i++) {
+            if (i < COUNT)
+                ht1.insert(to_string(i), i * 2);
+            lookups.push_back(to_string(i));
+        }
+
+        for (bool filtered : {false, true}) {
+            ht1.setFilter(filtered);
+            vector<optional<size_t>> results(lookups.size(), 12345u);
+            LookupScheduler sched;
+            for (size_t t = 0; t < IN_FLIGHT; t++)
+                sched.spawn(lookup_stripe(ht1, sched, lookups, t, IN_FLIGHT, results));
+            OUTSTREAM << "  " << IN_FLIGHT << " tasks spawned (filter " << (filtered ? "on" : "off") << "), running..." << endl;
+            sched.run();
+            ok &= (sched.pending() == 0);
+            for (size_t i = 0; i < lookups.size(); i++)
+                ok &= (results[i] == ht1.get(lookups[i]));
+        }
+
+        OUTSTREAM << (ok ? "SUCCESS: every co_await get_async matched get()."
+                         : "FAILURE: get_async results differ from get().")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST ASYNC GET ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // CHANGE LOG + SNAPSHOTS
+    // =====================================================================
+    OUTSTREAM << "Testing enableLog(), snapshot() and recover()" << endl;
+    OUTSTREAM << "---------------------------------------------" << endl << endl;
+#ifdef HT_LOG
+    try {
+        constexpr size_t COUNT = 40000; // enough buckets for several snapshot ranges
+        const std::filesystem::path dir = std::filesystem::temp_directory_path() / "hashtable_log_test";
+        std::filesystem::remove_all(dir);
+        bool ok = true;
+        map<string, size_t> expected;
+        auto contents = [](const HashTable& ht) {
+            map<string, size_t> result;
+            for (const auto& k : ht.keys())
+                result[k] = *ht.get(k);
+            return result;
+        };
+        auto logFiles = [&dir]() {
+            size_t n = 0;
+            for (const auto& entry : std::filesystem::directory_iterator(dir))
+                n += (entry.path().extension() == ".wal");
+            return n;
+        };
+
+        {
+            HashTable ht1;
+            ht1.enableLog(dir.string());
+            ok &= ht1.hasLog();
+
+            OUTSTREAM << "Inserting " << COUNT << " entries, removing every third, bumping every fifth through operator[]..." << endl;
+            for (size_t i = 0; i < COUNT / 2; i++)
+                ht1.insert(to_string(i), i);
+            ht1.snapshot(2); // a couple of ranges from the small layout, the rest only in the log
+            for (size_t i = COUNT / 2; i < COUNT; i++)
+                ht1.insert(to_string(i), i);
+            for (size_t i = 0; i < COUNT; i += 3)
+                ht1.remove(to_string(i));
+            for (size_t i = 1; i < COUNT; i += 5)
+                if (ht1.contains(to_string(i)))
+                    ht1[to_string(i)] += 1000;
+
+            OUTSTREAM << "Adding TTL entries (some already gone by recovery) and evicting a few in cache mode..." << endl;
+            ht1.insert("long-lived", 7, chrono::hours(1));
+            ht1.insert("short-lived", 8, chrono::milliseconds(1));
+            ht1.setMaxSize(ht1.size() - 10);
+            ht1.setMaxSize(0);
+            ok &= (ht1.stats().evictions == 10);
+            this_thread::sleep_for(chrono::milliseconds(5));
+
+            ht1.syncLog();
+            expected = contents(ht1);
+            ok &= (expected.count("long-lived") == 1 && expected.count("short-lived") == 0);
+        }
+
+        OUTSTREAM << "Recovering from the half snapshotted directory..." << endl;
+        {
+            HashTable ht2 = HashTable::recover(dir.string());
+            ok &= ht2.hasLog() && contents(ht2) == expected;
+
+            OUTSTREAM << "Writing more, taking a full snapshot..." << endl;
+            for (size_t i = COUNT; i < COUNT + 500; i++)
+                ht2.insert(to_string(i), i);
+            ht2[to_string(COUNT)] = 42;
+            ht2.snapshot();
+            ht2.syncLog();
+            ok &= (logFiles() == 1); // everything before the snapshot is covered
+            expected = contents(ht2);
+            ok &= (expected[to_string(COUNT)] == 42);
+        }
+
+        OUTSTREAM << "Recovering again, then clearing..." << endl;
+        {
+            HashTable ht3 = HashTable::recover(dir.string());
+            ok &= (contents(ht3) == expected);
+            ht3.clear();
+            ht3.insert("after-clear", 1);
+            ht3.remove("after-clear");
+            ht3.insert("after-clear", 2);
+        }
+        {
+            HashTable ht4 = HashTable::recover(dir.string());
+            ok &= (ht4.size() == 1 && ht4.get("after-clear") == optional<size_t>(2));
+
+            bool threw = false;
+            try { HashTable fresh; fresh.enableLog(dir.string()); } catch (runtime_error&) { threw = true; }
+            ok &= threw; // a used directory has to go through recover()
+        }
+
+        std::filesystem::remove_all(dir);
+        OUTSTREAM << (ok ? "SUCCESS: recovered tables matched what was written."
+                         : "FAILURE: recovered table differs from the original.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST LOG ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // MEMORY USAGE + SHRINK
+    // =====================================================================
+    OUTSTREAM << "Testing memory_usage() and shrink_to_fit()" << endl;
+    OUTSTREAM << "------------------------------------------" << endl << endl;
+#ifdef HT_MEMORY
+    try {
+        constexpr size_t COUNT = 8000;
+        bool ok = true;
+        auto key = [](size_t i) {
+            // odd keys are too long for the inline buffer
+            return (i % 2 == 0) ? to_string(i) : "a-key-long-enough-to-live-on-the-heap-" + to_string(i);
+        };
+        auto sum = [](const HashTableMemory& m) {
+            return sizeof(HashTable) + m.buckets + m.sideTables + m.keyHeap + m.tombstones + m.slack + m.keyPoolFree;
+        };
+
+        for (bool arena : {false, true}) {
+            unique_ptr<HashTable> ht = arena ? make_unique<HashTable>(8, std::pmr::new_delete_resource())
+                                             : make_unique<HashTable>();
+            OUTSTREAM << (arena ? "Key arena: " : "Plain heap: ") << "inserting " << COUNT << " entries, half with long keys..." << endl;
+            for (size_t i = 0; i < COUNT; i++)
+                ht->insert(key(i), i);
+
+            HashTableMemory full = ht->memory_usage();
+            ok &= (full.total == sum(full));
+            ok &= (full.buckets == ht->capacity() * sizeof(HashTableBucket) && full.tombstones == 0);
+            ok &= (full.keyHeap >= (COUNT / 2) * key(1).size());
+            ok &= (full.sideTables >= (ht->capacity() - 1) * sizeof(size_t));
+            ok &= (full.bucketPadding < full.buckets);
+            OUTSTREAM << "  " << static_cast<double>(full.total) / ht->size() << " bytes/entry" << endl;
+
+            OUTSTREAM << "Removing 90% and checking the tombstones show up..." << endl;
+            for (size_t i = 0; i < COUNT; i++)
+                if (i % 10 != 0)
+                    ht->remove(key(i));
+            HashTableMemory sparse = ht->memory_usage();
+            ok &= (sparse.total == sum(sparse));
+            ok &= (sparse.tombstones >= (COUNT - COUNT / 10) * sizeof(HashTableBucket));
+            ok &= (sparse.buckets == full.buckets - (COUNT - COUNT / 10) * sizeof(HashTableBucket));
+            if (arena) {
+                // removed keys went back to the pool, which keeps their blocks
+                ok &= (sparse.keyHeap * 8 < full.keyHeap);
+                ok &= (sparse.keyPoolFree >= (full.keyHeap - sparse.keyHeap) / 2);
+            } else {
+                ok &= (sparse.keyPoolFree == 0);
+            }
+
+            OUTSTREAM << "shrink_to_fit()..." << endl;
+            ht->shrink_to_fit();
+            HashTableMemory shrunk = ht->memory_usage();
+            ok &= (ht->capacity() == ht->size() * 2 + 1 && ht->alpha() < .5);
+            ok &= (shrunk.tombstones == 0 && shrunk.total == sum(shrunk));
+            ok &= (shrunk.total * 4 < sparse.total);
+            ok &= (shrunk.keyPoolFree * 4 < sparse.keyPoolFree || !arena);
+            OUTSTREAM << "  capacity " << ht->capacity() << ", " << static_cast<double>(shrunk.total) / ht->size() << " bytes/entry" << endl;
+            for (size_t i = 0; i < COUNT; i++)
+                ok &= (ht->get(key(i)) == ((i % 10 == 0) ? optional<size_t>(i) : nullopt));
+
+            // still an ordinary table afterwards
+            for (size_t i = COUNT; i < 2 * COUNT; i++)
+                ok &= ht->insert(key(i), i);
+            ok &= (ht->size() == COUNT + COUNT / 10 && ht->alpha() < .5);
+
+            OUTSTREAM << "shrink_to_fit() with expired long keys still in the buckets..." << endl;
+            for (size_t i = 0; i < 44; i++)
+                ht->insert("expired-key-long-enough-to-live-on-the-heap-" + to_string(i), i, chrono::nanoseconds(0));
+            ht->shrink_to_fit();
+            ok &= (ht->size() == COUNT + COUNT / 10 && ht->stats().expiring == 0 && ht->get(key(COUNT)) == COUNT);
+
+            ht->clear();
+            ht->shrink_to_fit();
+            ok &= (ht->capacity() == 8 && ht->memory_usage().keyHeap == 0);
+        }
+
+        OUTSTREAM << (ok ? "SUCCESS: memory breakdown adds up and shrink_to_fit compacts."
+                         : "FAILURE: memory breakdown or shrink_to_fit is off.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST MEMORY ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // BULK OPERATIONS
+    // =====================================================================
+    OUTSTREAM << "Testing for_each(), erase_if() and merge() with and without a thread pool" << endl;
+    OUTSTREAM << "-------------------------------------------------------------------------" << endl << endl;
+#ifdef HT_BULK
+    try {
+        // well past the serial cutoff so the pool really gets used
+        constexpr size_t COUNT = 60000;
+        ThreadPool pool(4);
+        bool ok = true;
+
+        for (int mode = 0; mode < 3; mode++) {
+            // 0 = no pool, 1 = pool, 2 = pool + key arena + filter (merge writes serially)
+            unique_ptr<HashTable> ht = (mode == 2) ? make_unique<HashTable>(8, std::pmr::new_delete_resource())
+                                                   : make_unique<HashTable>();
+            if (mode > 0)
+                ht->setThreadPool(&pool);
+            if (mode == 2)
+                ht->setFilter(true);
+            map<string, size_t> model;
+            OUTSTREAM << (mode == 0 ? "No pool:" : mode == 1 ? "4 thread pool:" : "4 thread pool, key arena, filter:") << endl;
+
+            for (size_t i = 0; i < COUNT; i++) {
+                string k = "bulk-key-number-" + to_string(i); // past the inline buffer
+                ht->insert(k, i);
+                model[k] = i;
+            }
+
+            OUTSTREAM << "  for_each doubling every value..." << endl;
+            std::atomic<size_t> visited{0};
+            ht->for_each([&visited](std::string_view, size_t& v) { v *= 2; visited++; });
+            for (auto& [k, v] : model)
+                v *= 2;
+            ok &= (visited == COUNT);
+
+            OUTSTREAM << "  erase_if on values divisible by 3, then by 5..." << endl;
+            size_t erased = ht->erase_if([](std::string_view, size_t v) { return v % 3 == 0; });
+            erased += ht->erase_if([](std::string_view k, size_t v) { return v % 5 == 0 && k.size() > 3; });
+            size_t expectedErased = erase_if(model, [](const auto& kv) { return kv.second % 3 == 0 || kv.second % 5 == 0; });
+            ok &= (erased == expectedErased && ht->size() == model.size());
+
+            OUTSTREAM << "  merging a delta that overlaps half the original keys..." << endl;
+            HashTable delta;
+            size_t added = 0;
+            for (size_t i = COUNT / 2; i < COUNT + COUNT / 2; i++) {
+                string k = "bulk-key-number-" + to_string(i);
+                delta.insert(k, i + 7);
+                added += (model.count(k) == 0);
+                model[k] = i + 7;
+            }
+            delta.insert("ttl-key", 1, chrono::hours(1));
+            model["ttl-key"] = 1;
+            added++;
+            delta.insert("gone-key", 1, chrono::nanoseconds(1)); // expired before the merge sees it
+            ok &= (ht->merge(delta) == added);
+            ok &= (ht->merge(*ht) == 0);
+            ok &= (ht->size() == model.size() && ht->alpha() < .5 && ht->stats().expiring == 1);
+
+            OUTSTREAM << "  comparing against std::map..." << endl;
+            for (const auto& [k, v] : model)
+                ok &= (ht->get(k) == optional<size_t>(v));
+            ok &= !ht->contains("gone-key") && !ht->contains("bulk-key-number-3");
+            ok &= (ht->keys().size() == model.size());
+            ht->insert("after-bulk", 1);
+            ok &= ht->contains("after-bulk");
+        }
+
+        OUTSTREAM << (ok ? "SUCCESS: bulk operations matched the model in every mode."
+                         : "FAILURE: bulk operations disagree with the model.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST BULK ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // HARDENED MODE
+    // =====================================================================
+    OUTSTREAM << "Testing hardened mode and the probe length guard against colliding keys" << endl;
+    OUTSTREAM << "-----------------------------------------------------------------------" << endl << endl;
+#ifdef HT_HARDENED
+    try {
+        // keys that share std::hash % 4096, so they share a home bucket at every capacity the table goes through
+        constexpr size_t COUNT = 300;
+        vector<string> flood;
+        size_t target = hash<string>()("x0") % 4096;
+        for (size_t i = 0; flood.size() < COUNT; i++) {
+            string k = "x" + to_string(i);
+            if (hash<string>()(k) % 4096 == target)
+                flood.push_back(k);
+        }
+        bool ok = true;
+
+        OUTSTREAM << "Inserting " << COUNT << " colliding keys into a plain table..." << endl;
+        HashTable ht1;
+        ok &= !ht1.isHardened();
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= ht1.insert(flood[i], i);
+        OUTSTREAM << "Reseeds: " << ht1.stats().reseeds << ", hardened: " << (ht1.isHardened() ? "yes" : "no") << endl;
+        ok &= (ht1.stats().reseeds >= 1 && ht1.isHardened());
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= (ht1.get(flood[i]) == optional<size_t>(i)) && !ht1.insert(flood[i], 0);
+        ok &= (ht1.size() == COUNT);
+
+        OUTSTREAM << "Merging them into another plain table..." << endl;
+        HashTable ht3;
+        ok &= (ht3.merge(ht1) == COUNT && ht3.stats().reseeds >= 1 && ht3.isHardened());
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= (ht3.get(flood[i]) == optional<size_t>(i));
+
+        OUTSTREAM << "Same keys into a table hardened from the start..." << endl;
+        HashTable ht2;
+        ht2.setFilter(true);
+        ht2.setHardened(true);
+        ok &= ht2.isHardened();
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= ht2.insert(flood[i], i);
+        ok &= (ht2.stats().reseeds == 0);
+        for (size_t i = 0; i < COUNT; i += 2)
+            ok &= ht2.remove(flood[i]);
+
+        OUTSTREAM << "Turning hardened mode off again..." << endl;
+        ht2.setHardened(false);
+        ok &= !ht2.isHardened() && ht2.size() == COUNT / 2;
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= (ht2.contains(flood[i]) == (i % 2 == 1));
+        ok &= !ht2.contains("x-never");
+
+        OUTSTREAM << (ok ? "SUCCESS: colliding keys were caught and every key stayed reachable."
+                         : "FAILURE: hardened mode lost keys or the guard never fired.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST HARDENED ***" << endl << endl;
+#endif
+
+    // =====================================================================
+    // VALUE TYPES
+    // =====================================================================
+    OUTSTREAM << "Testing HashTable_t with in place, out of line and move only values, and find()" << endl;
+    OUTSTREAM << "-------------------------------------------------------------------------------" << endl << endl;
+#ifdef HT_VALUE_TYPES
+    try {
+        constexpr size_t COUNT = 3000;
+        using Page = array<char, 4096>;
+        static_assert(!HashTable_t<string, string>::OUT_OF_LINE && HashTable_t<int, Page>::OUT_OF_LINE);
+        static_assert(HashTable_t<int, string, hash<int>, 8>::OUT_OF_LINE);
+        bool ok = true;
+
+        OUTSTREAM << "string -> string, values in the bucket..." << endl;
+        HashTable_t<string, string> strings;
+        for (size_t i = 0; i < COUNT; i++)
+            ok &= strings.insert(to_string(i), "value-" + to_string(i));
+        ok &= !strings.insert("7", "again") && strings.get("7") == optional<string>("value-7");
+        for (size_t i = 0; i < COUNT; i += 2)
+            ok &= strings.remove(to_string(i));
+        strings["9"] += "!";
+        ok &= (strings.size() == COUNT / 2 && strings.alpha() < .5);
+        for (size_t i = 0; i < COUNT; i++) {
+            const string* v = strings.find(to_string(i));
+            if (i % 2 == 0)
+                ok &= (v == nullptr && !strings.contains(to_string(i)));
+            else
+                ok &= (v != nullptr && *v == "value-" + to_string(i) + (i == 9 ? "!" : ""));
+        }
+
+        OUTSTREAM << "int -> 4 KiB page, values out of line, addresses kept across rehashes..." << endl;
+        HashTable_t<int, Page> pages;
+        vector<const Page*> addresses;
+        for (int i = 0; i < 200; i++) {
+            Page p{};
+            p[0] = static_cast<char>(i);
+            p[4095] = 'z';
+            ok &= pages.insert(i, p);
+            addresses.push_back(pages.find(i));
+        }
+        pages.rehash(4096);
+        for (int i = 0; i < 200; i++)
+            ok &= (pages.find(i) == addresses[i] && (*pages.find(i))[0] == static_cast<char>(i) && pages[i][4095] == 'z');
+        ok &= !pages.contains(200) && pages.find(200) == nullptr;
+
+        OUTSTREAM << "string -> unique_ptr<int>, move only values..." << endl;
+        HashTable_t<string, unique_ptr<int>> owners;
+        for (int i = 0; i < 100; i++)
+            ok &= owners.insert("p" + to_string(i), make_unique<int>(i));
+        ok &= owners.emplace("p100", new int(100)) && !owners.emplace("p5", nullptr);
+        owners.reserve(5000);
+        for (int i = 0; i <= 100; i++)
+            ok &= (*owners["p" + to_string(i)] == i);
+        owners.clear();
+        ok &= (owners.size() == 0 && owners.keys().empty() && owners.insert("p5", nullptr));
+
+        OUTSTREAM << "HashTable::find() reading and findForUpdate() writing in place..." << endl;
+        HashTable ht1;
+        ht1.insert("a", 1);
+        ht1.insert("gone", 2, chrono::nanoseconds(0));
+        const size_t* a = ht1.find("a");
+        ok &= (ht1.find("b") == nullptr && a != nullptr && *a == 1);
+        // find() leaves an expired entry for the sweeper, findForUpdate() reclaims it like operator[]
+        ok &= (ht1.find("gone") == nullptr && ht1.stats().expiring == 1);
+        ok &= (ht1.findForUpdate("gone") == nullptr && ht1.stats().expiring == 0);
+        ok &= (ht1.findForUpdate("b") == nullptr);
+        *ht1.findForUpdate("a") = 5;
+        ok &= (*a == 5 && ht1["a"] == 5);
+
+        OUTSTREAM << (ok ? "SUCCESS: every value type stored, found and moved correctly."
+                         : "FAILURE: a value was lost, copied wrong or moved.")
+                  << endl << endl;
+    } catch (exception& e) {
+        OUTSTREAM << "Exception: " << e.what() << endl << endl;
+    }
+#else
+    OUTSTREAM << "*** DID NOT TEST VALUE TYPES ***" << endl << endl;
+#endif
+
     OUTSTREAM << "All tests complete." << endl;
     return 0;
 }
@@ -0,0 +1,172 @@
+/**
+ * HugePageResource.cpp
+ */
+
+#include "HugePageResource.h"
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <string>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+HugePageResource::HugePageResource(HugePageMode mode, NumaPolicy policy, int node) {
+    pageMode = mode;
+    numaPolicy = policy;
+    numaNode = node;
+}
+
+HugePageMode HugePageResource::mode() const {
+    return pageMode;
+}
+
+NumaPolicy HugePageResource::policy() const {
+    return numaPolicy;
+}
+
+size_t HugePageResource::bytesMapped() const {
+    return mapped;
+}
+
+size_t HugePageResource::hugeTlbFallbacks() const {
+    return fallbacks;
+}
+
+size_t HugePageResource::numaFailures() const {
+    return mbindFailures;
+}
+
+size_t HugePageResource::mappedSize(size_t bytes) const {
+    size_t page = (pageMode == HugePageMode::NORMAL) ? 4096 : HUGE_PAGE_SIZE;
+    return (bytes + page - 1) / page * page;
+}
+
+#ifdef __linux__
+
+namespace {
+    // online nodes as a bitmask, e.g. "0-1" -> 0b11 (first 64 nodes only)
+    unsigned long onlineNodeMask() {
+        std::ifstream in("/sys/devices/system/node/online");
+        std::string list;
+        if (!(in >> list)) {
+            return 1; // no sysfs, assume node 0
+        }
+
+        unsigned long mask = 0;
+        std::stringstream ranges(list);
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            size_t dash = range.find('-');
+            int first = std::stoi(range.substr(0, dash));
+            int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+            for (int n = first; n <= last && n < 64; ++n) {
+                mask |= 1UL << n;
+            }
+        }
+        return mask == 0 ? 1 : mask;
+    }
+}
+
+void HugePageResource::applyNumaPolicy(void* p, size_t length) {
+    if (numaPolicy == NumaPolicy::LOCAL) {
+        return;
+    }
+
+    // raw syscall so we don't need libnuma, has to happen before the pages are first touched
+    unsigned long mask = 0;
+    int mode = MPOL_INTERLEAVE;
+    if (numaPolicy == NumaPolicy::INTERLEAVE) {
+        mask = onlineNodeMask();
+    } else {
+        mode = MPOL_BIND;
+        mask = (numaNode >= 0 && numaNode < 64) ? (1UL << numaNode) : 0;
+    }
+
+    if (mask == 0 || syscall(SYS_mbind, p, length, mode, &mask, sizeof(mask) * 8, 0) != 0) {
+        mbindFailures++;
+    }
+}
+
+void* HugePageResource::do_allocate(size_t bytes, size_t alignment) {
+    if (alignment > HUGE_PAGE_SIZE) {
+        throw std::bad_alloc();
+    }
+
+    size_t length = mappedSize(bytes == 0 ? 1 : bytes);
+    void* p = MAP_FAILED;
+
+    if (pageMode == HugePageMode::EXPLICIT) {
+        p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p == MAP_FAILED) {
+            fallbacks++; // pool empty or not configured
+        }
+    }
+
+    if (p == MAP_FAILED && pageMode != HugePageMode::NORMAL) {
+        // over map by one huge page and trim so the start is 2 MB aligned, THP only backs aligned ranges
+        size_t padded = length + HUGE_PAGE_SIZE;
+        char* raw = static_cast<char*>(mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (raw == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        size_t address = reinterpret_cast<size_t>(raw);
+        size_t head = (HUGE_PAGE_SIZE - address % HUGE_PAGE_SIZE) % HUGE_PAGE_SIZE;
+        size_t tail = padded - head - length;
+        if (head > 0) {
+            munmap(raw, head);
+        }
+        if (tail > 0) {
+            munmap(raw + head + length, tail);
+        }
+
+        p = raw + head;
+        madvise(p, length, MADV_HUGEPAGE); // only a hint, ignore failure
+    }
+
+    if (p == MAP_FAILED) {
+        p = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+    }
+
+    applyNumaPolicy(p, length);
+    mapped += length;
+    return p;
+}
+
+void HugePageResource::do_deallocate(void* p, size_t bytes, size_t) {
+    // every mode rounds to a multiple of its page size, so this is the length that was mapped
+    size_t length = mappedSize(bytes == 0 ? 1 : bytes);
+    munmap(p, length);
+    mapped -= length;
+}
+
+#else
+
+void HugePageResource::applyNumaPolicy(void*, size_t) {
+    mbindFailures++;
+}
+
+void* HugePageResource::do_allocate(size_t bytes, size_t alignment) {
+    fallbacks++;
+    mapped += bytes;
+    return std::pmr::get_default_resource()->allocate(bytes, alignment);
+}
+
+void HugePageResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+    mapped -= bytes;
+    std::pmr::get_default_resource()->deallocate(p, bytes, alignment);
+}
+
+#endif
+
+bool HugePageResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
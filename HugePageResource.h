@@ -0,0 +1,68 @@
+/**
+ * HugePageResource.h
+ */
+
+#ifndef HUGEPAGERESOURCE_H
+#define HUGEPAGERESOURCE_H
+
+#include <cstddef>
+#include <memory_resource>
+
+// how the pages behind an allocation are requested
+// NORMAL - plain 4 KB pages,
+// TRANSPARENT - 2 MB aligned mapping + madvise(MADV_HUGEPAGE), kernel backs it with huge pages when it can,
+// EXPLICIT - MAP_HUGETLB from the reserved huge page pool, falls back to TRANSPARENT when the pool is empty
+enum class HugePageMode {
+    NORMAL, TRANSPARENT, EXPLICIT
+};
+
+// where the pages end up on multi socket machines
+// LOCAL - kernel default (first touch),
+// INTERLEAVE - round robin over every online node,
+// BIND - only on the given node
+enum class NumaPolicy {
+    LOCAL, INTERLEAVE, BIND
+};
+
+// memory resource for very large bucket arrays, every allocation is its own mmap
+// meant to be handed to HashTable as the bucket resource, not for lots of small allocations
+// off linux it just forwards to the default resource
+class HugePageResource : public std::pmr::memory_resource {
+    public:
+        explicit HugePageResource(HugePageMode mode = HugePageMode::TRANSPARENT,
+                                  NumaPolicy policy = NumaPolicy::LOCAL, int node = 0);
+
+        HugePageResource(const HugePageResource&) = delete;
+        HugePageResource& operator=(const HugePageResource&) = delete;
+
+        HugePageMode mode() const;
+        NumaPolicy policy() const;
+
+        // bytes currently mapped (rounded up to page size)
+        size_t bytesMapped() const;
+        // EXPLICIT allocations that had to fall back to transparent huge pages
+        size_t hugeTlbFallbacks() const;
+        // allocations whose mbind call failed (single node kernels, bad node) - memory is still usable
+        size_t numaFailures() const;
+
+        static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    private:
+        HugePageMode pageMode;
+        NumaPolicy numaPolicy;
+        int numaNode;
+
+        size_t mapped = 0;
+        size_t fallbacks = 0;
+        size_t mbindFailures = 0;
+
+        void* do_allocate(size_t bytes, size_t alignment) override;
+        void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+        // size actually mapped for a request of bytes
+        size_t mappedSize(size_t bytes) const;
+        void applyNumaPolicy(void* p, size_t length);
+};
+
+#endif
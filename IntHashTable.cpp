@@ -0,0 +1,246 @@
+/**
+ * IntHashTable.cpp
+ */
+
+#include "IntHashTable.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+static_assert(sizeof(IntHashTableSlot) == 16, "slots are meant to pack four per cache line");
+
+namespace {
+    size_t roundUpPow2(size_t n) {
+        size_t cap = 1;
+        while (cap < n) {
+            cap <<= 1;
+        }
+        return cap;
+    }
+}
+
+IntHashTable::IntHashTable(size_t initCapacity) {
+    trueSize = 0;
+    tombstones = 0;
+    size_t cap = roundUpPow2(std::max<size_t>(initCapacity, 2));
+    mask = cap - 1;
+    slots.assign(cap, IntHashTableSlot{EMPTY_KEY, 0});
+}
+
+uint64_t IntHashTable::mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+size_t IntHashTable::home(uint64_t key) const {
+    return static_cast<size_t>(mix(key)) & mask; // power of two capacity, so masking is the modulo
+}
+
+bool IntHashTable::isSentinel(uint64_t key) {
+    return key == EMPTY_KEY || key == TOMBSTONE_KEY;
+}
+
+bool& IntHashTable::sideFlag(uint64_t key) {
+    return key == EMPTY_KEY ? hasEmptyKey : hasTombstoneKey;
+}
+
+uint64_t& IntHashTable::sideValue(uint64_t key) {
+    return key == EMPTY_KEY ? emptyKeyValue : tombstoneKeyValue;
+}
+
+bool IntHashTable::sideFlag(uint64_t key) const {
+    return key == EMPTY_KEY ? hasEmptyKey : hasTombstoneKey;
+}
+
+uint64_t IntHashTable::sideValue(uint64_t key) const {
+    return key == EMPTY_KEY ? emptyKeyValue : tombstoneKeyValue;
+}
+
+std::optional<size_t> IntHashTable::find(uint64_t key) const {
+    size_t index = home(key);
+    // alpha stays under .5 counting tombstones, so there is always an empty slot to stop at
+    while (slots[index].key != EMPTY_KEY) {
+        if (slots[index].key == key) {
+            return index;
+        }
+        index = (index + 1) & mask;
+    }
+    return std::nullopt;
+}
+
+bool IntHashTable::insert(uint64_t key, uint64_t value) {
+    if (isSentinel(key)) {
+        if (sideFlag(key)) {
+            return false; // repeated item
+        }
+        sideFlag(key) = true;
+        sideValue(key) = value;
+        return true;
+    }
+
+    // check load factor (tombstones included) and resize if needed
+    if (static_cast<double>(trueSize + tombstones + 1) / static_cast<double>(slots.size()) >= .5) {
+        // mostly tombstones - cleaning up at the same size is enough
+        rehash(trueSize * 4 >= slots.size() ? slots.size() * 2 : slots.size());
+    }
+
+    size_t index = home(key);
+    std::optional<size_t> firstFree;
+    while (slots[index].key != EMPTY_KEY) {
+        if (slots[index].key == key) {
+            return false; // dupe
+        }
+        if (slots[index].key == TOMBSTONE_KEY && !firstFree.has_value()) {
+            firstFree = index;
+        }
+        index = (index + 1) & mask;
+    }
+
+    if (firstFree.has_value()) {
+        index = firstFree.value();
+        tombstones--; // reusing an EAR slot
+    }
+    slots[index].key = key;
+    slots[index].value = value;
+    trueSize++;
+    return true;
+}
+
+size_t IntHashTable::size() const {
+    return trueSize + (hasEmptyKey ? 1 : 0) + (hasTombstoneKey ? 1 : 0);
+}
+
+double IntHashTable::alpha() const {
+    return static_cast<double>(trueSize) / static_cast<double>(slots.size());
+}
+
+bool IntHashTable::contains(uint64_t key) const {
+    if (isSentinel(key)) {
+        return sideFlag(key);
+    }
+    return find(key).has_value();
+}
+
+std::optional<uint64_t> IntHashTable::get(uint64_t key) const {
+    if (isSentinel(key)) {
+        return sideFlag(key) ? std::optional<uint64_t>(sideValue(key)) : std::nullopt;
+    }
+    std::optional<size_t> index = find(key);
+    if (!index.has_value()) {
+        return std::nullopt;
+    }
+    return slots[index.value()].value;
+}
+
+bool IntHashTable::remove(uint64_t key) {
+    if (isSentinel(key)) {
+        bool had = sideFlag(key);
+        sideFlag(key) = false;
+        return had;
+    }
+
+    std::optional<size_t> index = find(key);
+    if (!index.has_value()) {
+        return false;
+    }
+    slots[index.value()].key = TOMBSTONE_KEY; // EAR
+    trueSize--;
+    tombstones++;
+    return true;
+}
+
+uint64_t& IntHashTable::operator[](uint64_t key) {
+    if (isSentinel(key)) {
+        if (!sideFlag(key)) {
+            throw std::runtime_error("Key not found");
+        }
+        return sideValue(key);
+    }
+
+    std::optional<size_t> index = find(key);
+    if (!index.has_value()) {
+        throw std::runtime_error("Key not found");
+    }
+    return slots[index.value()].value;
+}
+
+std::vector<uint64_t> IntHashTable::keys() const {
+    std::vector<uint64_t> keys;
+    keys.reserve(size());
+    for (const auto& slot : slots) {
+        if (!isSentinel(slot.key)) {
+            keys.push_back(slot.key);
+        }
+    }
+    if (hasTombstoneKey) {
+        keys.push_back(TOMBSTONE_KEY);
+    }
+    if (hasEmptyKey) {
+        keys.push_back(EMPTY_KEY);
+    }
+    return keys;
+}
+
+size_t IntHashTable::capacity() const {
+    return slots.size();
+}
+
+void IntHashTable::rehash(size_t newCapacity) {
+    // keep alpha under .5 for what's already in here
+    newCapacity = roundUpPow2(std::max(newCapacity, trueSize * 2 + 2));
+
+    std::vector<IntHashTableSlot> old(newCapacity, IntHashTableSlot{EMPTY_KEY, 0});
+    old.swap(slots);
+    mask = newCapacity - 1;
+    tombstones = 0;
+
+    // no dupes and no tombstones in the new array, first empty slot is the spot
+    for (const auto& slot : old) {
+        if (isSentinel(slot.key)) {
+            continue;
+        }
+        size_t index = home(slot.key);
+        while (slots[index].key != EMPTY_KEY) {
+            index = (index + 1) & mask;
+        }
+        slots[index] = slot;
+    }
+}
+
+void IntHashTable::reserve(size_t count) {
+    size_t newCapacity = slots.size();
+    while (static_cast<double>(count) / static_cast<double>(newCapacity) >= .5) {
+        newCapacity *= 2;
+    }
+    if (newCapacity != slots.size()) {
+        rehash(newCapacity);
+    }
+}
+
+void IntHashTable::clear() {
+    std::fill(slots.begin(), slots.end(), IntHashTableSlot{EMPTY_KEY, 0});
+    trueSize = 0;
+    tombstones = 0;
+    hasEmptyKey = false;
+    hasTombstoneKey = false;
+}
+
+std::ostream& operator<<(std::ostream& os, const IntHashTable& t) {
+    for (size_t i = 0; i < t.slots.size(); ++i) {
+        if (!IntHashTable::isSentinel(t.slots[i].key)) {
+            os << "Bucket " << i << ": <" << t.slots[i].key << ", " << t.slots[i].value << ">" << std::endl;
+        }
+    }
+    // side keys have no bucket of their own
+    if (t.hasTombstoneKey) {
+        os << "Side: <" << IntHashTable::TOMBSTONE_KEY << ", " << t.tombstoneKeyValue << ">" << std::endl;
+    }
+    if (t.hasEmptyKey) {
+        os << "Side: <" << IntHashTable::EMPTY_KEY << ", " << t.emptyKeyValue << ">" << std::endl;
+    }
+    return os;
+}
@@ -0,0 +1,80 @@
+/**
+ * IntHashTable.h
+ */
+
+#ifndef INTHASHTABLE_H
+#define INTHASHTABLE_H
+
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <vector>
+
+// packed 16 byte slot, four to a cache line
+// the bucket type lives in the key: EMPTY_KEY is ESS, TOMBSTONE_KEY is EAR, anything else is NORMAL
+struct IntHashTableSlot {
+    uint64_t key;
+    uint64_t value;
+};
+
+// uint64 -> uint64 version of HashTable with the same interface
+// no std::string, no BucketType, no offsets vector - a slot is just key + value
+// uses linear probing from a power of two capacity, the shuffled offsets would cost another 8 bytes per slot
+class IntHashTable {
+    public:
+        // reserved key values, a real key equal to one of these is kept on the side
+        static constexpr uint64_t EMPTY_KEY = ~uint64_t(0);
+        static constexpr uint64_t TOMBSTONE_KEY = ~uint64_t(0) - 1;
+
+        // rounds up to a power of two; default 8
+        IntHashTable(size_t initCapacity = 8);
+
+        friend std::ostream& operator<<(std::ostream& os, const IntHashTable& ht);
+
+        bool insert(uint64_t key, uint64_t value);
+
+        size_t size() const;
+        double alpha() const;
+
+        bool contains(uint64_t key) const;
+
+        std::optional<uint64_t> get(uint64_t key) const;
+        bool remove(uint64_t key);
+
+        uint64_t& operator[](uint64_t key);
+
+        std::vector<uint64_t> keys() const;
+
+        size_t capacity() const;
+
+        void rehash(size_t newCapacity);
+        void reserve(size_t count);
+        void clear();
+
+    private:
+        std::vector<IntHashTableSlot> slots;
+        size_t trueSize; // live entries in slots (side keys not included)
+        size_t tombstones; // TOMBSTONE_KEY slots, they lengthen probes so they count toward resizing
+        size_t mask; // capacity - 1
+
+        // real keys that collide with the sentinels
+        bool hasEmptyKey = false;
+        uint64_t emptyKeyValue = 0;
+        bool hasTombstoneKey = false;
+        uint64_t tombstoneKeyValue = 0;
+
+        static bool isSentinel(uint64_t key);
+        // the flag / value pair that stores a sentinel valued key
+        bool& sideFlag(uint64_t key);
+        uint64_t& sideValue(uint64_t key);
+        bool sideFlag(uint64_t key) const;
+        uint64_t sideValue(uint64_t key) const;
+
+        // murmur3 fmix64 finalizer, cheap and good enough to spread sequential ids
+        static uint64_t mix(uint64_t key);
+        size_t home(uint64_t key) const;
+        // index of key in slots, or nullopt
+        std::optional<size_t> find(uint64_t key) const;
+};
+
+#endif
@@ -0,0 +1,52 @@
+/**
+ * SipHash.cpp
+ */
+
+#include "SipHash.h"
+#include <cstring>
+
+namespace {
+    inline uint64_t rotl(uint64_t x, int b) {
+        return (x << b) | (x >> (64 - b));
+    }
+
+    inline void sipRound(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    }
+}
+
+uint64_t sipHash13(const void* data, size_t length, const SipKey& key) {
+    // "somepseudorandomlygeneratedbytes", straight from the reference implementation
+    uint64_t v0 = key.k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key.k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = key.k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key.k1 ^ 0x7465646279746573ULL;
+
+    const unsigned char* in = static_cast<const unsigned char*>(data);
+    const unsigned char* end = in + (length & ~size_t(7));
+    for (; in != end; in += 8) {
+        uint64_t m;
+        std::memcpy(&m, in, 8); // little endian hosts only, which is all we build for
+        v3 ^= m;
+        sipRound(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    // last 0-7 bytes with the length in the top byte
+    uint64_t b = static_cast<uint64_t>(length) << 56;
+    for (size_t i = 0; i < (length & 7); ++i) {
+        b |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    v3 ^= b;
+    sipRound(v0, v1, v2, v3);
+    v0 ^= b;
+
+    v2 ^= 0xff;
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    sipRound(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
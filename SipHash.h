@@ -0,0 +1,21 @@
+/**
+ * SipHash.h
+ */
+
+#ifndef SIPHASH_H
+#define SIPHASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// 128 bit secret for sipHash13
+struct SipKey {
+    uint64_t k0 = 0;
+    uint64_t k1 = 0;
+};
+
+// SipHash-1-3: one compression round per 8 bytes, three finalization rounds
+// keyed, so without the key nobody can work out which inputs collide
+uint64_t sipHash13(const void* data, size_t length, const SipKey& key);
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * ThreadPool.cpp
+ */
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace {
+// pool whose chunks this thread is running right now, so a nested parallelFor doesn't wait on itself
+thread_local const ThreadPool* runningPool = nullptr;
+}
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = 1; // hardware_concurrency can report 0
+    }
+    // caller counts as one of the threads
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+size_t ThreadPool::size() const {
+    return threads.size() + 1;
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn, size_t minChunk) {
+    if (count == 0) {
+        return;
+    }
+
+    // a few chunks per thread so uneven ranges still balance out
+    size_t chunks = std::max<size_t>(1, std::min(size() * 4, count / std::max<size_t>(1, minChunk)));
+
+    // nothing to split, skip the handoff - same for a call from inside one of our own chunks,
+    // the job fields belong to the outer call and waiting for the pool would never end
+    if (chunks == 1 || threads.empty() || runningPool == this) {
+        fn(0, count);
+        return;
+    }
+
+    // the job fields below are shared, a second caller waits until this job is done
+    std::lock_guard<std::mutex> turn(submit);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        job = &fn;
+        jobCount = count;
+        numChunks = chunks;
+        chunkSize = (count + chunks - 1) / chunks;
+        nextChunk = 0;
+        finishedChunks = 0;
+        error = nullptr;
+        generation++;
+    }
+    wake.notify_all();
+
+    runChunks(); // caller helps
+
+    std::exception_ptr failure;
+    {
+        // wait for the last chunk and for every worker to leave the job
+        // so none of them can grab a chunk of the next one with a stale fn
+        std::unique_lock<std::mutex> guard(lock);
+        done.wait(guard, [this] { return finishedChunks == numChunks && active == 0; });
+        job = nullptr;
+        failure = error;
+    }
+
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [&] { return stopping || (generation != seen && job != nullptr); });
+            if (stopping) {
+                return;
+            }
+            seen = generation;
+            active++;
+        }
+
+        runChunks();
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            active--;
+        }
+        done.notify_all();
+    }
+}
+
+void ThreadPool::runChunks() {
+    const ThreadPool* outer = runningPool;
+    runningPool = this;
+    while (true) {
+        size_t chunk = nextChunk.fetch_add(1);
+        if (chunk >= numChunks) {
+            runningPool = outer;
+            return;
+        }
+
+        size_t begin = chunk * chunkSize;
+        size_t end = std::min(begin + chunkSize, jobCount);
+        try {
+            if (begin < end) {
+                (*job)(begin, end);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (!error) {
+                error = std::current_exception(); // keep the first one
+            }
+        }
+
+        if (finishedChunks.fetch_add(1) + 1 == numChunks) {
+            std::lock_guard<std::mutex> guard(lock);
+            done.notify_all();
+        }
+    }
+}
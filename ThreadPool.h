@@ -0,0 +1,62 @@
+/**
+ * ThreadPool.h
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// small fixed size pool of worker threads
+// only job type is parallelFor - split [0, count) into chunks and run them everywhere,
+// the calling thread helps out and parallelFor doesn't return until every chunk is done
+// one job at a time: callers on other threads (tables sharing a pool) wait their turn,
+// a parallelFor from inside a chunk just runs inline
+class ThreadPool {
+    public:
+        // threadCount is the total number of threads working on a job, including the caller
+        explicit ThreadPool(size_t threadCount = std::thread::hardware_concurrency());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // number of threads that work on a job (workers + caller)
+        size_t size() const;
+
+        // run fn(begin, end) over [0, count) in chunks of at least minChunk items
+        // first exception thrown by fn is rethrown here after all chunks finish
+        void parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn, size_t minChunk = 1024);
+
+    private:
+        std::vector<std::thread> threads;
+        std::mutex submit; // held by a caller for its whole parallelFor
+        std::mutex lock;
+        std::condition_variable wake; // workers wait on this for a new job
+        std::condition_variable done; // caller waits on this for the job to finish
+
+        // current job, only changed under lock while no worker is active
+        const std::function<void(size_t, size_t)>* job = nullptr;
+        size_t jobCount = 0;
+        size_t chunkSize = 0;
+        size_t numChunks = 0;
+        size_t generation = 0; // bumped for every new job
+        size_t active = 0; // workers currently inside runChunks
+        bool stopping = false;
+        std::exception_ptr error;
+
+        std::atomic<size_t> nextChunk{0};
+        std::atomic<size_t> finishedChunks{0};
+
+        void workerLoop();
+        void runChunks();
+};
+
+#endif